@@ -28,9 +28,27 @@ static const TInitSeq InitSeq[] =
   PP_IA + 2, MYMAC_3 + (MYMAC_4 << 8),
   PP_IA + 4, MYMAC_5 + (MYMAC_6 << 8),
   PP_LineCTL, SERIAL_RX_ON | SERIAL_TX_ON,       // configure the Physical Interface
-  PP_RxCTL, RX_OK_ACCEPT | RX_IA_ACCEPT | RX_BROADCAST_ACCEPT
+  PP_RxCTL, RX_OK_ACCEPT | RX_IA_ACCEPT | RX_BROADCAST_ACCEPT,
+  PP_RxCFG, RX_OK_ENBL,                          // interrupt on each good frame (RxOKiE)...
+  PP_BufCFG, RX_MISS_ENBL,                       // ...and on each missed one
+  PP_CS8900_ISAINT, 0,                           // use INTRQ0
+  PP_BusCTL, ENABLE_IRQ
 };
 
+volatile TEvents8900 Events8900;                 // pending events, see Int8900Handler()
+volatile unsigned char Sleeping8900;             // CS8900 is (maybe) in sleep mode
+
+#ifdef CS8900_BENCHMARK
+TBenchmark8900 Benchmark8900Result;              // for the debugger
+
+static void Benchmark8900(void);
+static unsigned int BenchmarkRun(void (*Copy)(void *, unsigned int), void *Buffer);
+static void CopyToFrame8900C(void *Source, unsigned int Size);
+static void CopyToFrame8900B(void *Source, unsigned int Size);
+static void CopyFromFrame8900C(void *Dest, unsigned int Size);
+static void CopyFromFrameSum8900B(void *Dest, unsigned int Size);
+#endif
+
 //------------------------------------------------------------------------------
 // configure port-pins for use with LAN-controller,
 // issue reset and send the configuration-sequence (InitSeq[])
@@ -50,6 +68,10 @@ void Init8900(void)
   __delay_cycles(40000);                            // time for CS8900 POR
   // CHASE: ^^ DelayCycles to __delay_cycles
 
+#ifdef CS8900_BENCHMARK
+  Benchmark8900();                               // (the reset below cleans up)
+#endif
+
   Write8900(ADD_PORT, PP_SelfCTL);               // set register
   Write8900(DATA_PORT, POWER_ON_RESET);          // reset the Ethernet-Controller
 
@@ -62,6 +84,14 @@ void Init8900(void)
     Write8900(ADD_PORT, InitSeq[i].Addr);
     Write8900(DATA_PORT, InitSeq[i].Data);
   }
+
+  Events8900.RxEvent = 0;
+  Sleeping8900 = 0;
+  P2SEL &= ~INTRQ;                               // INTRQ is an input,
+  P2DIR &= ~INTRQ;
+  P2IES &= ~INTRQ;                               // int. on its rising edge
+  P2IFG &= ~INTRQ;
+  Enable8900Int();
 }
 //------------------------------------------------------------------------------
 // writes a word in little-endian byte order to
@@ -69,6 +99,8 @@ void Init8900(void)
 //------------------------------------------------------------------------------
 void Write8900(unsigned char Address, unsigned int Data)
 {
+  unsigned char Direction = P5DIR;               // (maybe inside a read window)
+
   P5DIR = 0xff;                                  // data port to output
   P3OUT = IOR | IOW | Address;                   // put address on bus
   P5OUT = Data;                                  // write low order byte to data bus
@@ -77,12 +109,15 @@ void Write8900(unsigned char Address, unsigned int Data)
   P5OUT = Data >> 8;                             // write high order byte to data bus
   P3OUT &= ~IOW;                                 // toggle IOW-signal
   P3OUT |= IOW;
+  P5DIR = Direction;
 }
 //------------------------------------------------------------------------------
 // writes a word in little-endian byte order to TX_FRAME_PORT
 //------------------------------------------------------------------------------
 void WriteFrame8900(unsigned int Data)
 {
+  unsigned char Direction = P5DIR;               // (maybe inside a read window)
+
   P5DIR = 0xff;                                  // data port to output
   P3OUT = IOR | IOW | TX_FRAME_PORT;             // put address on bus
   P5OUT = Data;                                  // write low order byte to data bus
@@ -91,36 +126,7 @@ void WriteFrame8900(unsigned int Data)
   P5OUT = Data >> 8;                             // write high order byte to data bus
   P3OUT &= ~IOW;                                 // toggle IOW-signal
   P3OUT |= IOW;
-}
-//------------------------------------------------------------------------------
-// copies bytes from MCU-memory to frame port
-// NOTES:     * MCU-memory MUST start at word-boundary
-//------------------------------------------------------------------------------
-void CopyToFrame8900(void *Source, unsigned int Size)
-{
-  unsigned int *pSource = Source;
-  
-  P5DIR = 0xff;                                  // data port to output
-
-  while (Size > 1)
-  {
-    P3OUT = IOR | IOW | TX_FRAME_PORT;           // put address on bus
-    P5OUT = *pSource;                            // write low order byte to data bus
-    P3OUT &= ~IOW;                               // toggle IOW-signal
-    P3OUT = IOR | IOW | (TX_FRAME_PORT + 1);     // and put next address on bus
-    P5OUT = (*pSource++) >> 8;                   // write high order byte to data bus
-    P3OUT &= ~IOW;                               // toggle IOW-signal
-    P3OUT |= IOW;
-    Size -= 2;
-  }
-  
-  if (Size)                                      // if odd num. of bytes...
-  {
-    P3OUT = IOR | IOW | TX_FRAME_PORT;           // put address on bus
-    P5OUT = *pSource;                            // write byte to data bus
-    P3OUT &= ~IOW;                               // toggle IOW-signal
-    P3OUT |= IOW;
-  }
+  P5DIR = Direction;
 }
 //------------------------------------------------------------------------------
 // reads a word in little-endian byte order from
@@ -128,6 +134,7 @@ void CopyToFrame8900(void *Source, unsigned int Size)
 //------------------------------------------------------------------------------
 unsigned int Read8900(unsigned char Address)
 {
+  unsigned char Direction = P5DIR;               // (maybe inside a read window)
   unsigned int ReturnValue;
 
   P5DIR = 0x00;                                  // data port to input
@@ -138,18 +145,18 @@ unsigned int Read8900(unsigned char Address)
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue |= P5IN << 8;                      // get high order byte from data bus
   P3OUT |= IOR;
-  P5DIR = 0xff;                                  // data port to output
+  P5DIR = Direction;
   
   return ReturnValue;
 }
 //------------------------------------------------------------------------------
 // reads a word in little-endian byte order from RX_FRAME_PORT
+// (inside a read window, see BeginRead8900())
 //------------------------------------------------------------------------------
 unsigned int ReadFrame8900(void)
 {
   unsigned int ReturnValue;
 
-  P5DIR = 0x00;                                  // data port to input
   P3OUT = IOR | IOW | RX_FRAME_PORT;             // access to RX_FRAME_PORT
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue = P5IN;                            // get 1st byte from data bus (low-byte)
@@ -157,20 +164,18 @@ unsigned int ReadFrame8900(void)
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue |= P5IN << 8;                      // get 2nd byte from data bus (high-byte)
   P3OUT |= IOR;
-  P5DIR = 0xff;                                  // data port to output
   
   return ReturnValue;
 }
 //------------------------------------------------------------------------------
 // reads a word in big-endian byte order from RX_FRAME_PORT
 // (useful to avoid permanent byte-swapping while reading
-// TCP/IP-data)
+// TCP/IP-data), inside a read window
 //------------------------------------------------------------------------------
 unsigned int ReadFrameBE8900(void)
 {
   unsigned int ReturnValue;
 
-  P5DIR = 0x00;                                  // data port to input
   P3OUT = IOR | IOW | RX_FRAME_PORT;             // access to RX_FRAME_PORT
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue = P5IN << 8;                       // get 1st byte from data bus (high-byte)
@@ -178,7 +183,6 @@ unsigned int ReadFrameBE8900(void)
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue |= P5IN;                           // get 2nd byte from data bus (low-byte)
   P3OUT |= IOR;
-  P5DIR = 0xff;                                  // data port to output
   
   return ReturnValue;
 }
@@ -187,12 +191,12 @@ unsigned int ReadFrameBE8900(void)
 // a specified port-address
 // NOTE: this func. xfers the high-byte 1st, must be used to
 //       access some special registers (e.g. RxStatus)
+//       inside a read window only
 //------------------------------------------------------------------------------
 unsigned int ReadHB1ST8900(unsigned char Address)
 {
   unsigned int ReturnValue;
 
-  P5DIR = 0x00;                                  // data port to input
   P3OUT = IOR | IOW | (Address + 1);             // put address on bus
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue = P5IN << 8;                       // get high order byte from data bus
@@ -200,57 +204,68 @@ unsigned int ReadHB1ST8900(unsigned char Address)
   P3OUT &= ~IOR;                                 // IOR-signal low
   ReturnValue |= P5IN;                           // get low order byte from data bus
   P3OUT |= IOR;
-  P5DIR = 0xff;                                  // data port to output
   
   return ReturnValue;
 }
 //------------------------------------------------------------------------------
-// copies bytes from frame port to MCU-memory
-// NOTES:     * MCU-memory MUST start at word-boundary
+// does a dummy read on the CS8900A frame-I/O-port (inside a read window)
 //------------------------------------------------------------------------------
-void CopyFromFrame8900(void *Dest, unsigned int Size)
+void DummyReadFrame8900(unsigned int Size)
 {
-  unsigned int *pDest = Dest;
-
-  P5DIR = 0x00;                                  // data port to input
-
-  while (Size > 1)
+  while (Size--)
   {
     P3OUT = IOR | IOW | RX_FRAME_PORT;           // access to RX_FRAME_PORT
     P3OUT &= ~IOR;                               // IOR-signal low
-    *pDest = P5IN;                               // get 1st byte from data bus (low-byte)
-    P3OUT = IOR | IOW | (RX_FRAME_PORT + 1);     // IOR high and put next address on bus
-    P3OUT &= ~IOR;                               // IOR-signal low
-    *pDest++ |= P5IN << 8;                       // get 2nd byte from data bus (high-byte)
-    P3OUT |= IOR;
-    Size -= 2;
   }
   
+  P3OUT |= IOR;                                  // IOR high
+}
+//------------------------------------------------------------------------------
+// does a dummy read on the CS8900A frame-I/O-port (inside a read window)
+// and adds the bytes to the one's complement sum 'Sum', returns the new sum
+//------------------------------------------------------------------------------
+unsigned int DummyReadFrameSum8900(unsigned int Size, unsigned int Sum)
+{
+  unsigned long NewSum = Sum;
+
+  while (Size > 1)
+  {
+    NewSum += ReadFrame8900();
+    Size -= 2;
+  }
+
   if (Size)                                      // check for leftover byte...
   {
     P3OUT = IOR | IOW | RX_FRAME_PORT;           // access to RX_FRAME_PORT
     P3OUT &= ~IOR;                               // IOR-signal low
-    *(unsigned char *)pDest = P5IN;              // get byte from data bus
+    NewSum += P5IN;                              // (it's the low-byte)
     P3OUT |= IOR;                                // IOR high
   }
 
-  P5DIR = 0xff;                                  // data port to output
+  while (NewSum >> 16)                           // end-around carry
+    NewSum = (NewSum & 0xffff) + (NewSum >> 16);
+
+  return NewSum;
 }
 //------------------------------------------------------------------------------
-// does a dummy read on the CS8900A frame-I/O-port
+// discards the rest of the received frame. the CS8900 then reports the
+// next one (if any) via the ISQ.
 //------------------------------------------------------------------------------
-void DummyReadFrame8900(unsigned int Size)
+void Skip8900(void)
 {
-  P5DIR = 0x00;                                  // data port to input
-
-  while (Size--)
-  {
-    P3OUT = IOR | IOW | RX_FRAME_PORT;           // access to RX_FRAME_PORT
-    P3OUT &= ~IOR;                               // IOR-signal low
-  }
-  
-  P3OUT |= IOR;                                  // IOR high
-  P5DIR = 0xff;                                  // data port to output
+  Write8900(ADD_PORT, PP_RxCFG);
+  Write8900(DATA_PORT, RX_OK_ENBL | SKIP_1);     // (keep RxOKiE set)
+}
+//------------------------------------------------------------------------------
+// puts the CS8900 into sleep mode. it wakes up by itself on receive
+// activity (the frame that wakes it up is lost) or when the next frame
+// is sent (RequestSend())
+//------------------------------------------------------------------------------
+void Sleep8900(void)
+{
+  Write8900(ADD_PORT, PP_SelfCTL);
+  Write8900(DATA_PORT, SLEEP_ON | AUTO_WAKEUP);
+  Sleeping8900 = 1;
 }
 //------------------------------------------------------------------------------
 // requests space in CS8900 on-chip memory for
@@ -258,6 +273,13 @@ void DummyReadFrame8900(unsigned int Size)
 //------------------------------------------------------------------------------
 void RequestSend(unsigned int FrameSize)
 {
+  if (Sleeping8900)                              // wake it up first
+  {
+    Write8900(ADD_PORT, PP_SelfCTL);
+    Write8900(DATA_PORT, 0);
+    Sleeping8900 = 0;
+  }
+
   Write8900(TX_CMD_PORT, TX_START_ALL_BYTES);
   Write8900(TX_LEN_PORT, FrameSize);
 }
@@ -270,3 +292,434 @@ unsigned int Rdy4Tx(void)
   Write8900(ADD_PORT, PP_BusST);
   return Read8900(DATA_PORT) & READY_FOR_TX_NOW;
 }
+//------------------------------------------------------------------------------
+// INTRQ interrupt: drains the ISQ into 'Events8900'. a received frame is
+// reported once, the next one only after it has been skipped (Skip8900()).
+// must not interrupt other bus accesses (see Disable8900Int()).
+//------------------------------------------------------------------------------
+#pragma vector = PORT2_VECTOR
+__interrupt void Int8900Handler(void)
+{
+  unsigned int Event;
+
+  P2IFG &= ~INTRQ;                               // reset int.-flag, INTRQ drops when
+                                                 // the ISQ is empty
+  while ((Event = Read8900(ISQ_PORT)))
+    switch (Event & ISQ_EVENT_MASK)
+    {
+      case ISQ_RX_EVENT :                        // frame ready at RX_FRAME_PORT
+        Events8900.RxEvent = Event;
+        Sleeping8900 = 0;                        // (woke up by itself)
+        break;
+      case ISQ_BUFFER_EVENT :
+        if (Event & RX_MISS) Events8900.RxMissed++;
+        break;
+    }
+
+  if (Events8900.RxEvent)
+    __bic_SR_register_on_exit(LPM3_bits);        // wake up the main program
+}
+//------------------------------------------------------------------------------
+// burst routines for the frame port (MSP430 assembly, arguments in R12..R14)
+// the C loops of V1.0 load each P3OUT value (IOR | IOW | address) as an
+// immediate and toggle the strobes read-modify-write, ~45 cycles per word.
+// here the four P3OUT values of a word access are kept in registers, which
+// takes 26 (TX) or 28 (RX) cycles per word, and the loops are unrolled to
+// 8 bytes per pass. see Benchmark8900() for the measured cycles per byte.
+//------------------------------------------------------------------------------
+
+// void CopyToFrame8900(const void *Source, unsigned int Size)
+// copies bytes from MCU-memory to frame port
+// NOTES:     * MCU-memory may start at any address (e.g. constant data in flash)
+//            * may be used inside a read window (P5DIR is restored)
+asm("            .text");
+asm("            .global CopyToFrame8900");
+asm("CopyToFrame8900:");
+asm("            push    R10                         ; save registers");
+asm("            push    R9");
+asm("            push.b  &P5DIR                      ; save data bus direction");
+asm("            mov.b   #0xff,&P5DIR                ; data port to output");
+asm("            mov.b   #0xc0,R14                   ; IOR | IOW | TX_FRAME_PORT");
+asm("            mov.b   #0x40,R11                   ; IOR | TX_FRAME_PORT");
+asm("            mov.b   #0xc1,R10                   ; IOR | IOW | (TX_FRAME_PORT + 1)");
+asm("            mov.b   #0x41,R9                    ; IOR | (TX_FRAME_PORT + 1)");
+asm("            sub.w   #8,R13                      ; 8 bytes per pass");
+asm("            jlo     CopyTo8900Rest");
+asm("CopyTo8900Loop:");
+asm("            mov.b   R14,&P3OUT                  ; put address on bus");
+asm("            mov.b   @R12+,&P5OUT                ; write low order byte to data bus");
+asm("            mov.b   R11,&P3OUT                  ; toggle IOW-signal");
+asm("            mov.b   R10,&P3OUT                  ; IOW high and put next address on bus");
+asm("            mov.b   @R12+,&P5OUT                ; write high order byte to data bus");
+asm("            mov.b   R9,&P3OUT                   ; toggle IOW-signal");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            sub.w   #8,R13");
+asm("            jhs     CopyTo8900Loop");
+asm("CopyTo8900Rest:");
+asm("            bit.w   #4,R13                      ; R13 & 7 = bytes left");
+asm("            jz      CopyTo8900Word");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("CopyTo8900Word:");
+asm("            bit.w   #2,R13");
+asm("            jz      CopyTo8900Byte");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   @R12+,&P5OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("CopyTo8900Byte:");
+asm("            bit.w   #1,R13                      ; if odd num. of bytes...");
+asm("            jz      CopyTo8900Done");
+asm("            mov.b   R14,&P3OUT                  ; put address on bus");
+asm("            mov.b   @R12,&P5OUT                 ; write byte to data bus");
+asm("            mov.b   R11,&P3OUT                  ; toggle IOW-signal");
+asm("CopyTo8900Done:");
+asm("            mov.b   R10,&P3OUT                  ; IOW high");
+asm("            mov.b   @SP+,&P5DIR                 ; restore data bus direction");
+asm("            pop     R9");
+asm("            pop     R10");
+asm("            ret     ");
+
+// void CopyFromFrame8900(void *Dest, unsigned int Size)
+// copies bytes from frame port to MCU-memory (inside a read window)
+// NOTES:     * MCU-memory may start at any address
+asm("            .text");
+asm("            .global CopyFromFrame8900");
+asm("CopyFromFrame8900:");
+asm("            push    R10                         ; save registers");
+asm("            push    R9");
+asm("            mov.b   #0xc0,R14                   ; IOR | IOW | RX_FRAME_PORT");
+asm("            mov.b   #0x80,R11                   ; IOW | RX_FRAME_PORT");
+asm("            mov.b   #0xc1,R10                   ; IOR | IOW | (RX_FRAME_PORT + 1)");
+asm("            mov.b   #0x81,R9                    ; IOW | (RX_FRAME_PORT + 1)");
+asm("            sub.w   #8,R13                      ; 8 bytes per pass");
+asm("            jlo     CopyFrom8900Rest");
+asm("CopyFrom8900Loop:");
+asm("            mov.b   R14,&P3OUT                  ; access to RX_FRAME_PORT");
+asm("            mov.b   R11,&P3OUT                  ; IOR-signal low");
+asm("            mov.b   &P5IN,0(R12)                ; get 1st byte from data bus (low-byte)");
+asm("            mov.b   R10,&P3OUT                  ; IOR high and put next address on bus");
+asm("            mov.b   R9,&P3OUT                   ; IOR-signal low");
+asm("            mov.b   &P5IN,1(R12)                ; get 2nd byte from data bus (high-byte)");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   &P5IN,2(R12)");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   &P5IN,3(R12)");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   &P5IN,4(R12)");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   &P5IN,5(R12)");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   &P5IN,6(R12)");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   &P5IN,7(R12)");
+asm("            add.w   #8,R12");
+asm("            sub.w   #8,R13");
+asm("            jhs     CopyFrom8900Loop");
+asm("CopyFrom8900Rest:");
+asm("            bit.w   #4,R13                      ; R13 & 7 = bytes left");
+asm("            jz      CopyFrom8900Word");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   &P5IN,0(R12)");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   &P5IN,1(R12)");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   &P5IN,2(R12)");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   &P5IN,3(R12)");
+asm("            add.w   #4,R12");
+asm("CopyFrom8900Word:");
+asm("            bit.w   #2,R13");
+asm("            jz      CopyFrom8900Byte");
+asm("            mov.b   R14,&P3OUT");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   &P5IN,0(R12)");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   &P5IN,1(R12)");
+asm("            incd.w  R12");
+asm("CopyFrom8900Byte:");
+asm("            bit.w   #1,R13                      ; check for leftover byte...");
+asm("            jz      CopyFrom8900Done");
+asm("            mov.b   R14,&P3OUT                  ; access to RX_FRAME_PORT");
+asm("            mov.b   R11,&P3OUT                  ; IOR-signal low");
+asm("            mov.b   &P5IN,0(R12)                ; get byte from data bus");
+asm("CopyFrom8900Done:");
+asm("            mov.b   R10,&P3OUT                  ; IOR high");
+asm("            pop     R9");
+asm("            pop     R10");
+asm("            ret     ");
+
+// unsigned int CopyFromFrameSum8900(void *Dest, unsigned int Size, unsigned int Sum)
+// copies bytes from frame port to MCU-memory (inside a read window) and
+// adds them to the one's complement sum 'Sum', returns the new sum. costs
+// 2 cycles per word more than CopyFromFrame8900().
+// NOTES:     * MCU-memory MUST start at word-boundary
+asm("            .text");
+asm("            .global CopyFromFrameSum8900");
+asm("CopyFromFrameSum8900:");
+asm("            push    R10                         ; save registers");
+asm("            push    R9");
+asm("            push    R8");
+asm("            push    R7");
+asm("            mov.b   #0xc0,R11                   ; IOR | IOW | RX_FRAME_PORT");
+asm("            mov.b   #0x80,R10                   ; IOW | RX_FRAME_PORT");
+asm("            mov.b   #0xc1,R9                    ; IOR | IOW | (RX_FRAME_PORT + 1)");
+asm("            mov.b   #0x81,R8                    ; IOW | (RX_FRAME_PORT + 1)");
+asm("            sub.w   #8,R13                      ; 8 bytes per pass");
+asm("            jlo     CopySum8900Rest");
+asm("CopySum8900Loop:");
+asm("            mov.b   R11,&P3OUT                  ; access to RX_FRAME_PORT");
+asm("            mov.b   R10,&P3OUT                  ; IOR-signal low");
+asm("            mov.b   &P5IN,R15                   ; get 1st byte from data bus (low-byte)");
+asm("            mov.b   R9,&P3OUT                   ; IOR high and put next address on bus");
+asm("            mov.b   R8,&P3OUT                   ; IOR-signal low");
+asm("            mov.b   &P5IN,R7                    ; get 2nd byte from data bus (high-byte)");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,0(R12)                  ; store word");
+asm("            add.w   R15,R14                     ; add it to the sum...");
+asm("            adc.w   R14                         ; ...with end-around carry");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   &P5IN,R15");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R8,&P3OUT");
+asm("            mov.b   &P5IN,R7");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,2(R12)");
+asm("            add.w   R15,R14");
+asm("            adc.w   R14");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   &P5IN,R15");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R8,&P3OUT");
+asm("            mov.b   &P5IN,R7");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,4(R12)");
+asm("            add.w   R15,R14");
+asm("            adc.w   R14");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   &P5IN,R15");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R8,&P3OUT");
+asm("            mov.b   &P5IN,R7");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,6(R12)");
+asm("            add.w   R15,R14");
+asm("            adc.w   R14");
+asm("            add.w   #8,R12");
+asm("            sub.w   #8,R13");
+asm("            jhs     CopySum8900Loop");
+asm("CopySum8900Rest:");
+asm("            bit.w   #4,R13                      ; R13 & 7 = bytes left");
+asm("            jz      CopySum8900Word");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   &P5IN,R15");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R8,&P3OUT");
+asm("            mov.b   &P5IN,R7");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,0(R12)");
+asm("            add.w   R15,R14");
+asm("            adc.w   R14");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   &P5IN,R15");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R8,&P3OUT");
+asm("            mov.b   &P5IN,R7");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,2(R12)");
+asm("            add.w   R15,R14");
+asm("            adc.w   R14");
+asm("            add.w   #4,R12");
+asm("CopySum8900Word:");
+asm("            bit.w   #2,R13");
+asm("            jz      CopySum8900Byte");
+asm("            mov.b   R11,&P3OUT");
+asm("            mov.b   R10,&P3OUT");
+asm("            mov.b   &P5IN,R15");
+asm("            mov.b   R9,&P3OUT");
+asm("            mov.b   R8,&P3OUT");
+asm("            mov.b   &P5IN,R7");
+asm("            swpb    R7");
+asm("            bis.w   R7,R15");
+asm("            mov.w   R15,0(R12)");
+asm("            add.w   R15,R14");
+asm("            adc.w   R14");
+asm("            incd.w  R12");
+asm("CopySum8900Byte:");
+asm("            bit.w   #1,R13                      ; check for leftover byte...");
+asm("            jz      CopySum8900Done");
+asm("            mov.b   R11,&P3OUT                  ; access to RX_FRAME_PORT");
+asm("            mov.b   R10,&P3OUT                  ; IOR-signal low");
+asm("            mov.b   &P5IN,R15                   ; get byte from data bus");
+asm("            mov.b   R15,0(R12)");
+asm("            add.w   R15,R14                     ; (it's the low-byte)");
+asm("            adc.w   R14");
+asm("CopySum8900Done:");
+asm("            mov.b   R9,&P3OUT                   ; IOR high");
+asm("            mov.w   R14,R12                     ; return the sum");
+asm("            pop     R7");
+asm("            pop     R8");
+asm("            pop     R9");
+asm("            pop     R10");
+asm("            ret     ");
+#ifdef CS8900_BENCHMARK
+//------------------------------------------------------------------------------
+// measures the C loops of V1.0 and the burst routines in MCLK cycles per
+// byte (* 100), the results are left in 'Benchmark8900Result'. called from
+// Init8900() before the CS8900 is reset, so the data doesn't matter.
+//------------------------------------------------------------------------------
+static void Benchmark8900(void)
+{
+  unsigned int Buffer[BENCHMARK_SIZE / 2];
+
+  Benchmark8900Result.CopyToFrameC = BenchmarkRun(CopyToFrame8900C, Buffer);
+  Benchmark8900Result.CopyToFrame = BenchmarkRun(CopyToFrame8900B, Buffer);
+
+  BeginRead8900();
+  Benchmark8900Result.CopyFromFrameC = BenchmarkRun(CopyFromFrame8900C, Buffer);
+  Benchmark8900Result.CopyFromFrame = BenchmarkRun(CopyFromFrame8900, Buffer);
+  Benchmark8900Result.CopyFromFrameSum = BenchmarkRun(CopyFromFrameSum8900B, Buffer);
+  EndRead8900();
+}
+//------------------------------------------------------------------------------
+// times one copy of 'BENCHMARK_SIZE' bytes with Timer_B (ACLK, as set up by
+// TCPLowLevelInit()), returns MCLK cycles per byte * 100
+//------------------------------------------------------------------------------
+static unsigned int BenchmarkRun(void (*Copy)(void *, unsigned int), void *Buffer)
+{
+  unsigned int Divider = 1 << ((BCSCTL1 & (DIVA0 | DIVA1)) >> 4);  // ACLK = MCLK / Divider
+  unsigned int Ticks;
+
+  TBCTL = TBSSEL_1 + TBCLR + MC_2;               // count ACLK from 0
+  Copy(Buffer, BENCHMARK_SIZE);
+  Ticks = TBR;
+  TBCTL = 0;                                     // stop Timer_B
+
+  return (unsigned long)Ticks * Divider * 100 / BENCHMARK_SIZE;
+}
+//------------------------------------------------------------------------------
+// CopyToFrame8900() of V1.0, for comparison
+//------------------------------------------------------------------------------
+static void CopyToFrame8900C(void *Source, unsigned int Size)
+{
+  unsigned int *pSource = Source;
+
+  P5DIR = 0xff;                                  // data port to output
+
+  while (Size > 1)
+  {
+    P3OUT = IOR | IOW | TX_FRAME_PORT;           // put address on bus
+    P5OUT = *pSource;                            // write low order byte to data bus
+    P3OUT &= ~IOW;                               // toggle IOW-signal
+    P3OUT = IOR | IOW | (TX_FRAME_PORT + 1);     // and put next address on bus
+    P5OUT = (*pSource++) >> 8;                   // write high order byte to data bus
+    P3OUT &= ~IOW;                               // toggle IOW-signal
+    P3OUT |= IOW;
+    Size -= 2;
+  }
+
+  if (Size)                                      // if odd num. of bytes...
+  {
+    P3OUT = IOR | IOW | TX_FRAME_PORT;           // put address on bus
+    P5OUT = *pSource;                            // write byte to data bus
+    P3OUT &= ~IOW;                               // toggle IOW-signal
+    P3OUT |= IOW;
+  }
+}
+//------------------------------------------------------------------------------
+// CopyFromFrame8900() of V1.0, for comparison
+//------------------------------------------------------------------------------
+static void CopyFromFrame8900C(void *Dest, unsigned int Size)
+{
+  unsigned int *pDest = Dest;
+
+  P5DIR = 0x00;                                  // data port to input
+
+  while (Size > 1)
+  {
+    P3OUT = IOR | IOW | RX_FRAME_PORT;           // access to RX_FRAME_PORT
+    P3OUT &= ~IOR;                               // IOR-signal low
+    *pDest = P5IN;                               // get 1st byte from data bus (low-byte)
+    P3OUT = IOR | IOW | (RX_FRAME_PORT + 1);     // IOR high and put next address on bus
+    P3OUT &= ~IOR;                               // IOR-signal low
+    *pDest++ |= P5IN << 8;                       // get 2nd byte from data bus (high-byte)
+    P3OUT |= IOR;
+    Size -= 2;
+  }
+
+  if (Size)                                      // check for leftover byte...
+  {
+    P3OUT = IOR | IOW | RX_FRAME_PORT;           // access to RX_FRAME_PORT
+    P3OUT &= ~IOR;                               // IOR-signal low
+    *(unsigned char *)pDest = P5IN;              // get byte from data bus
+    P3OUT |= IOR;                                // IOR high
+  }
+
+  P5DIR = 0xff;                                  // data port to output
+}
+//------------------------------------------------------------------------------
+// CopyToFrame8900() with the signature of the copy routines
+//------------------------------------------------------------------------------
+static void CopyToFrame8900B(void *Source, unsigned int Size)
+{
+  CopyToFrame8900(Source, Size);
+}
+//------------------------------------------------------------------------------
+// CopyFromFrameSum8900() with the signature of the copy routines
+//------------------------------------------------------------------------------
+static void CopyFromFrameSum8900B(void *Dest, unsigned int Size)
+{
+  CopyFromFrameSum8900(Dest, Size, 0);
+}
+#endif
@@ -21,6 +21,24 @@
 
 #define IOR                  (0x40)              // CS8900's ISA-bus interface pins
 #define IOW                  (0x80)
+#define INTRQ                (0x01)              // P2.0 <- CS8900's INTRQ0
+
+// the INTRQ interrupt must be masked while the main program uses the bus
+// (Int8900Handler() reads the ISQ)
+#define Int8900Enabled()     (P2IE & INTRQ)
+#define Disable8900Int()     (P2IE &= ~INTRQ)
+#define Enable8900Int()      (P2IE |= INTRQ)
+
+// the data bus (P5) is an output between two accesses. all reads of a
+// received frame share one input window instead of switching P5DIR for
+// each word: BeginRead8900(), ReadFrame8900(), CopyFromFrame8900()...,
+// EndRead8900(). the other functions leave P5DIR as they found it, so they
+// can be used inside the window, too.
+#define BeginRead8900()      (P5DIR = 0x00)      // data port to input
+#define EndRead8900()        (P5DIR = 0xff)      // data port back to output
+
+//#define CS8900_BENCHMARK                       // measure the bus routines in Init8900()
+#define BENCHMARK_SIZE       256                 // bytes per measurement
 
 // definitions for Crystal CS8900 ethernet-controller
 // based on linux-header by Russel Nelson
@@ -264,9 +282,32 @@ typedef struct                                   // struct to store CS8900's
   unsigned int Data;
 } TInitSeq;
 
+typedef struct                                   // events read from the ISQ
+{                                                // by Int8900Handler()
+  unsigned int RxEvent;                          // RxEvent of the frame ready at
+                                                 // RX_FRAME_PORT (0: none)
+  unsigned int RxMissed;                         // frames lost for lack of buffer space
+} TEvents8900;
+
+typedef struct                                   // results of Benchmark8900(),
+{                                                // MCLK cycles per byte * 100
+  unsigned int CopyToFrameC;                     // C loops of V1.0
+  unsigned int CopyToFrame;                      // burst routines
+  unsigned int CopyFromFrameC;
+  unsigned int CopyFromFrame;
+  unsigned int CopyFromFrameSum;                 // with one's complement sum
+} TBenchmark8900;
+
 // exported constants
 extern const unsigned int MyMAC[];               // "M1-M2-M3-M4-M5-M6"
 
+// exported variables
+extern volatile TEvents8900 Events8900;          // pending events
+extern volatile unsigned char Sleeping8900;      // CS8900 put to sleep (see Sleep8900())
+#ifdef CS8900_BENCHMARK
+extern TBenchmark8900 Benchmark8900Result;
+#endif
+
 // exported functions
 void Init8900(void);
 void Write8900(unsigned char Address, unsigned int Data);
@@ -275,9 +316,13 @@ unsigned int Read8900(unsigned char Address);
 unsigned int ReadFrame8900(void);
 unsigned int ReadHB1ST8900(unsigned char Address);
 unsigned int ReadFrameBE8900(void);
-void CopyToFrame8900(void *Source, unsigned int Size);
+void CopyToFrame8900(const void *Source, unsigned int Size);
 void CopyFromFrame8900(void *Dest, unsigned int Size);
 void DummyReadFrame8900(unsigned int Size);
+unsigned int CopyFromFrameSum8900(void *Dest, unsigned int Size, unsigned int Sum);
+unsigned int DummyReadFrameSum8900(unsigned int Size, unsigned int Sum);
+void Skip8900(void);
+void Sleep8900(void);
 void RequestSend(unsigned int FrameSize);
 unsigned int Rdy4Tx(void);
 
@@ -22,18 +22,138 @@
 //#include "support.h"
 #include "easyweb.h"
 #include "tcpip.h"                               // easyWEB TCP/IP stack
+#include "webcontent.h"                          // placeholders and gzip encoding of the
+                                                 // webside, files of web/ (generated by
+                                                 // tools/mkcontent.py)
 
+typedef char WebContentUpToDate[(sizeof(WebSide) - 1 == WEBSIDE_SIZE) ? 1 : -1];
+                                                 // (run tools/mkcontent.py if this fails)
 
-static const unsigned char GetResponse[] =       // 1st thing server sends to a client
+static const unsigned char NotFound[] = "Not Found\r\n";  // bodies of the error responses
+static const unsigned char NotAllowed[] = "Method Not Allowed\r\n";
+
+static const char * const HTTPMethodName[HTTP_METHODS] =  // 'HTTP_GET', 'HTTP_HEAD'...
+{
+  "GET", "HEAD", "POST"
+};
+
+static const char * const HTTPVersionName[HTTP_VERSIONS] =  // 'HTTP_VERSION_1_0'...
+{
+  "HTTP/1.0", "HTTP/1.1"
+};
+
+static const char * const HTTPHeaderName[HTTP_HEADERS] =  // 'HTTP_HEADER_CONNECTION'...
+{                                                // (lower case)
+  "connection", "accept-encoding", "if-none-match"
+};
+
+static const char * const HTTPConnectionToken[HTTP_CONNECTION_TOKENS] =
+{                                                // 'HTTP_CONNECTION_CLOSE'... (lower case)
+  "close", "keep-alive"
+};
+
+static const char * const HTTPEncodingToken[HTTP_ENCODING_TOKENS] =
+{                                                // 'HTTP_ENCODING_GZIP'... (lower case)
+  "gzip"
+};
+
+static const char * const HTTPQValueName[1] =    // 'q' parameter of a token we refuse
+{                                                // (a prefix of it w/ at least "q=0")
+  "q=0.000"
+};
+
+static const char * const * const HTTPNames[] =  // tables for HTTPMatch() ('HTTP_MATCH_...',
+{                                                // paths and entity tags are taken from
+  HTTPMethodName, 0, HTTPVersionName, HTTPHeaderName,  // 'HTTPRoutes')
+  HTTPConnectionToken, HTTPEncodingToken, 0, HTTPQValueName
+};
+
+static const unsigned char HTTPTokens[HTTP_HEADERS] =  // nr. of tokens of each header field
+{
+  HTTP_CONNECTION_TOKENS, HTTP_ENCODING_TOKENS, HTTP_ETAG_TOKENS
+};
+
+static unsigned int BeginContent(unsigned char Socket, const THTTPContent *Content);
+static unsigned int TransmitContent(unsigned char Socket, const THTTPContent *Content,
+  unsigned int Ofs, unsigned int Count);
+static unsigned int BeginHistory(unsigned char Socket, const THTTPContent *Content);
+static unsigned int TransmitHistory(unsigned char Socket, const THTTPContent *Content,
+  unsigned int Ofs, unsigned int Count);
+static unsigned int BeginValues(unsigned char Socket, const THTTPContent *Content);
+static unsigned int TransmitValues(unsigned char Socket, const THTTPContent *Content,
+  unsigned int Ofs, unsigned int Count);
+
+static const THTTPRoute HTTPRoutes[] =           // resources of the server (max. 16),
+{                                                // looked up by HTTPParse()
+  { "/",            HTTP_GET | HTTP_HEAD, HTTP_200, "text/html",       HTTP_CACHE_PAGE,
+    WEBSIDE,    WEBSIDE_GZ,     BeginContent, TransmitContent },
+  { "/index.html",  HTTP_GET | HTTP_HEAD, HTTP_200, "text/html",       HTTP_CACHE_PAGE,
+    WEBSIDE,    WEBSIDE_GZ,     BeginContent, TransmitContent },
+  { "/robots.txt",  HTTP_GET | HTTP_HEAD, HTTP_200, ROBOTS_TXT_TYPE,   HTTP_CACHE_ASSET,
+    ROBOTS_TXT, ROBOTS_TXT_GZ,  BeginContent, TransmitContent },
+  { "/history",     HTTP_GET | HTTP_HEAD, HTTP_200, "application/octet-stream",
+    HTTP_CACHE_PAGE, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, BeginHistory, TransmitHistory },
+  { "/values.json", HTTP_GET | HTTP_HEAD, HTTP_200, "application/json",
+    HTTP_CACHE_PAGE, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, BeginValues,  TransmitValues }
+};
+
+#define HTTP_ROUTES          (sizeof HTTPRoutes / sizeof HTTPRoutes[0])
+#define HTTP_ALL(Count)      (0xffffu >> (16 - (Count)))  // candidates: all names of a table
+
+static const THTTPRoute HTTPNotFound =           // answer if no route matches...
+{
+  0, 0, HTTP_404, "text/plain", 0, { NotFound, sizeof(NotFound) - 1, 0, 0 },
+  { 0, 0, 0, 0 }, BeginContent, TransmitContent
+};
+
+static const THTTPRoute HTTPNotAllowed =         // ...or the route doesn't allow the method
+{
+  0, 0, HTTP_405, "text/plain", 0, { NotAllowed, sizeof(NotAllowed) - 1, 0, 0 },
+  { 0, 0, 0, 0 }, BeginContent, TransmitContent
+};
+
+static unsigned int HTTPBytesSent[TCP_MAX_SOCKETS]; // bytes of HTTP-header and body
+                                                 // passed to the stack
+static unsigned char HTTPStatus[TCP_MAX_SOCKETS]; // status byte
+static THTTPParser HTTPParser[TCP_MAX_SOCKETS];  // state of the request parser
+static THTTPParser HTTPParserSaved;              // before the last HTTPReceive() call
+static THTTPParser HTTPRequest[TCP_MAX_SOCKETS]; // request being answered
+static const THTTPRoute *HTTPResponse[TCP_MAX_SOCKETS];  // response being sent,
+static const THTTPContent *HTTPContent[TCP_MAX_SOCKETS];  // its body...
+static unsigned int HTTPBodySize[TCP_MAX_SOCKETS];  // ...the size of it...
+static unsigned char HTTPHeaderSize[TCP_MAX_SOCKETS];  // ...and of its header
+static unsigned int HTTPValues[TCP_MAX_SOCKETS][WEB_VALUES];  // values of the placeholders
+static unsigned int HTTPSamples[TCP_MAX_SOCKETS][ADC_CHANNELS];  // ...and the ADC12 results
+                                                 // they come from
+
+static volatile unsigned int ADCSamples[ADC_CHANNELS];  // latest results of the ADC12
+                                                 // ('ADC_AD7'..., see ADC12Handler())
+
+static unsigned char HistoryRing[HISTORY_BLOCKS][HISTORY_BLOCK_SIZE];  // sensor history
+static unsigned char HistoryBlocks;              // nr. of blocks in use...
+static unsigned int HistoryNewest;               // ...serial nr. of the newest one...
+static unsigned char HistoryLength;              // ...and the bytes used in it
+static unsigned int HistoryLast[ADC_CHANNELS];   // last sample added
+static unsigned int HistoryTime;                 // nr. of the next sample
+static unsigned int HistoryTicks;                // ADC sequences up to the next sample
+static unsigned int HistoryFirst[TCP_MAX_SOCKETS];  // 1st block of a download...
+static unsigned char HistoryPins;                // ...kept while its socket's bit is set
+
+static const unsigned int TelemetryIP[] =        // "TELEMETRY_IP_1.TELEMETRY_IP_2..."
 {
-  "HTTP/1.0 200 OK\r\n"                          // protocol ver 1.0, code 200, reason OK
-  "Content-Type: text/html\r\n"                  // type of data we want to send
-  "\r\n"                                         // indicate end of HTTP-header
+  TELEMETRY_IP_1 + (unsigned int)(TELEMETRY_IP_2 << 8),
+  TELEMETRY_IP_3 + (unsigned int)(TELEMETRY_IP_4 << 8)
 };
 
-static unsigned char *PWebSide;                  // pointer to webside
-static unsigned int HTTPBytesToSend;             // bytes left to send
-static unsigned char HTTPStatus;                 // status byte
+static unsigned int TelemetryBatch[2][TELEMETRY_SIZE / 2];  // one is filled by the ISR
+static unsigned char TelemetryFill;              // ...this one,
+static volatile unsigned char TelemetryReady;    // ...the other one is to be sent
+                                                 // ('TELEMETRY_READY'...)
+static unsigned char TelemetryCount;             // samples in the batch being filled
+static unsigned int TelemetryTime;               // nr. of the next sample
+static unsigned int TelemetryTicks;              // ADC sequences up to the next sample
+static volatile unsigned int TelemetryDropped;   // batches not sent (TX path busy, MAC
+                                                 // unknown or the last one still waiting)
 
 //------------------------------------------------------------------------------
 // ADC12 Module Temperature Table
@@ -99,21 +219,44 @@ static const unsigned int Temp_Tab[] =
 static void InitOsc(void);
 static void InitPorts(void);
 static void InitADC12(void);
-static void HTTPServer(void);
-static void InsertDynamicValues(void);
-static unsigned int GetAD7Val(void);
-static unsigned int GetTempVal(void);
+static void HTTPServer(unsigned char Socket);
+static void HTTPReceive(unsigned char Socket, unsigned int Count);
+static void HTTPParse(THTTPParser *Parser, unsigned char c);
+static unsigned int HTTPMatch(unsigned int Candidates, unsigned char Pos, unsigned char c,
+  unsigned char Table);
+static unsigned int HTTPMatchValue(const THTTPParser *Parser, unsigned char c);
+static unsigned char HTTPFirst(unsigned int Candidates);
+static void HTTPToken(THTTPParser *Parser, unsigned char Token);
+static void HTTPResetParser(THTTPParser *Parser);
+static const THTTPRoute *HTTPDispatch(const THTTPParser *Parser);
+static unsigned char HTTPWriteHeader(unsigned char Socket);
+static void HistoryAdd(void);
+static unsigned char HistoryPinned(unsigned int Block);
+static void HistoryRelease(unsigned char Socket);
+static unsigned char TelemetryAdd(void);
+static void TelemetryPoll(void);
+static const char *GetContentValue(unsigned char Socket, const THTTPContent *Content,
+  const TWebPlaceholder *Value, char *Text);
+static unsigned long GetContentCRC(unsigned char Socket, const THTTPContent *Content,
+  const TWebPlaceholder *Trailer);
+static unsigned long CRC32AddByte(unsigned long CRC, unsigned char c);
+static unsigned long CRC32MulMod(unsigned long a, unsigned long b);
+static unsigned int GetValuesText(unsigned char Socket, char *Text);
+static unsigned int GetAD7Val(unsigned int ADCResult);
+static unsigned int GetTempVal(unsigned int ADCResult);
 //------------------------------------------------------------------------------
 void main(void)
 {
+  unsigned char Socket;
+
   InitOsc();
   InitPorts();
-  InitADC12();
 
   TCPLowLevelInit();
+  InitADC12();                                   // (ACLK is set up by TCPLowLevelInit())
+  UDPBind(TELEMETRY_SOCKET, TELEMETRY_PORT, 0);  // (send only)
 
-  //CHASE
-  //__enable_interrupt();                          // enable interrupts
+  __enable_interrupt();                          // enable interrupts
 
 /*
   *(unsigned char *)RemoteIP = 24;               // uncomment those lines to get the
@@ -132,115 +275,523 @@ void main(void)
   }
 */
 
-  HTTPStatus = 0;                                // clear HTTP-server's flag register
+  for (Socket = 0; Socket < TCP_MAX_SOCKETS; Socket++)
+  {
+    HTTPStatus[Socket] = 0;                      // clear HTTP-server's flag registers
+    HTTPResetParser(&HTTPParser[Socket]);
+  }
 
-  TCPLocalPort = TCP_PORT_HTTP;                  // set port we want to listen to
-  
   while (1)                                      // repeat forever
   {
-    if (!(SocketStatus & SOCK_ACTIVE)) TCPPassiveOpen();   // listen for incoming TCP-connection
-    DoNetworkStuff();                                      // handle network and easyWEB-stack
-                                                           // events
-    HTTPServer();
-  }
+    DoNetworkStuff();                            // handle network and easyWEB-stack
+                                                 // events
+    for (Socket = 0; Socket < TCP_MAX_SOCKETS; Socket++)
+    {                                            // serve each client on its own socket
+      TCPSelectSocket(Socket);
+
+      if (!(SocketStatus & SOCK_ACTIVE))
+      {
+        TCPLocalPort = TCP_PORT_HTTP;            // set port we want to listen to
+        TCPRxHandler = HTTPReceive;              // parse requests as they come in
+        TCPIdleTimeout = HTTP_IDLE_TIMEOUT;      // close idle persistent connections
+        TCPPassiveOpen();                        // listen for incoming TCP-connection
+      }
+
+      HTTPServer(Socket);
+    }
+
+    TelemetryPoll();                             // push the samples of the ADC12
+
+    TCPIdle();                                   // sleep (LPM3) until the stack
+  }                                              // has something to do
 }
 //------------------------------------------------------------------------------
 // This function implements a very simple dynamic HTTP-server.
-// It waits until connected, then sends a HTTP-header and the
-// HTML-code stored in memory. Before sending, it replaces
-// some special strings with dynamic values.
-// NOTE: For strings crossing page boundaries, replacing will
-// not work. In this case, simply add some extra lines
-// (e.g. CR and LFs) to the HTML-code.
+// It waits until a request is complete (see HTTPReceive()), then
+// sends a HTTP-header and the body of the requested resource (see
+// 'HTTPRoutes') or an error response. While sending, a dynamic
+// body gets its placeholders replaced with dynamic values.
+// Header and body are treated as one stream, so the stack
+// can ask us to send any part of it again ('TCPTxRewind').
+// The body isn't copied to RAM, it goes straight from flash
+// to the CS8900 (see TransmitContent()). Clients that accept it
+// get the gzip encoding of the body if there is one. Clients that
+// have the body already (same entity tag) get '304 Not Modified'.
+// The connection persists (HTTP/1.1) unless the client asks to
+// close it: the next request is answered as soon as the stack
+// can't ask for a part of the last response anymore.
+// 'Socket' must be the selected socket.
 //------------------------------------------------------------------------------
-static void HTTPServer(void)
+static void HTTPServer(unsigned char Socket)
 {
+  const THTTPRoute *Response;
+  const THTTPContent *Content;
+  unsigned int BodySize;                         // (no body for HEAD requests and 304)
+  unsigned int Count;                            // bytes to put into this segment
+  unsigned int HeaderCount;                      // ...and how many of them are header
+
   if (SocketStatus & SOCK_CONNECTED)             // check if somebody has connected to our TCP
   {
-    if (SocketStatus & SOCK_DATA_AVAILABLE)      // check if remote TCP sent data
-      TCPReleaseRxBuffer();                      // and throw it away
+    if (!(HTTPStatus[Socket] & HTTP_SEND_PAGE))  // choose the response of a new request
+    {
+      if (HTTPParser[Socket].State != HTTP_PARSE_DONE)
+        return;                                  // wait for the (rest of the) request
+
+      HTTPRequest[Socket] = HTTPParser[Socket];  // the parser may take the next
+      HTTPResetParser(&HTTPParser[Socket]);      // request now
+      Response = HTTPDispatch(&HTTPRequest[Socket]);
+      if ((HTTPRequest[Socket].Flags & HTTP_GZIP) && Response->Gzip.Data)
+        Content = &Response->Gzip;
+      else
+        Content = &Response->Identity;
+
+      HTTPStatus[Socket] &= ~HTTP_NOT_MODIFIED;
+      if (Content->ETag && (HTTPRequest[Socket].Flags &
+        ((Content == &Response->Gzip) ? HTTP_GZIP_CACHED : HTTP_IDENTITY_CACHED)))
+      {
+        HTTPStatus[Socket] |= HTTP_NOT_MODIFIED; // client has this body already
+        HTTPBodySize[Socket] = 0;
+      }
+      else
+        HTTPBodySize[Socket] = Response->Begin(Socket, Content);
+
+      HTTPResponse[Socket] = Response;
+      HTTPContent[Socket] = Content;
+      HTTPHeaderSize[Socket] = 0;                // (built with the 1st segment)
+      HTTPBytesSent[Socket] = 0;
+      HTTPStatus[Socket] |= HTTP_SEND_PAGE;
+    }
+
+    Response = HTTPResponse[Socket];
+    Content = HTTPContent[Socket];
+    BodySize = HTTPBodySize[Socket];
+    if ((HTTPRequest[Socket].Method == HTTP_HEAD) || (HTTPStatus[Socket] & HTTP_NOT_MODIFIED))
+      BodySize = 0;
 
     if (SocketStatus & SOCK_TX_BUF_RELEASED)     // check if buffer is free for TX
     {
-      if (!(HTTPStatus & HTTP_SEND_PAGE))        // init byte-counter and pointer to webside
-      {                                          // if called the 1st time
-        HTTPBytesToSend = sizeof(WebSide) - 1;   // get HTML length, ignore trailing zero
-        PWebSide = (unsigned char *)WebSide;     // pointer to HTML-code
+      HTTPBytesSent[Socket] -= TCPTxRewind;      // step back if the stack lost data
+      TCPTxRewind = 0;
+
+      HeaderCount = 0;
+      TCPTxDataCount = 0;                        // start a new segment
+
+      if (!HTTPHeaderSize[Socket] || (HTTPBytesSent[Socket] < HTTPHeaderSize[Socket]))
+      {                                          // include (rest of) HTTP-header
+        HTTPHeaderSize[Socket] = HTTPWriteHeader(Socket);
+        HeaderCount = HTTPHeaderSize[Socket] - HTTPBytesSent[Socket];
+        memmove(TCP_TX_BUF, TCP_TX_BUF + HTTPBytesSent[Socket], HeaderCount);
+        TCPTxDataCount = HeaderCount;
       }
 
-      if (HTTPBytesToSend > MAX_TCP_TX_DATA_SIZE)     // transmit a segment of MAX_SIZE
+      Count = HTTPHeaderSize[Socket] + BodySize - HTTPBytesSent[Socket];
+      if (Count > TCPTxWindow)                   // transmit what fits into the segment
+        Count = TCPTxWindow;                     // and the window or the leftover bytes
+
+      if (HeaderCount > Count)                   // window too small for the rest of the
+      {                                          // header? send a part of it
+        TCPTxDataCount = Count;
+        TCPTransmitTxBuffer();
+        HTTPBytesSent[Socket] += Count;
+      }
+      else if (Count)
       {
-        if (!(HTTPStatus & HTTP_SEND_PAGE))           // 1st time, include HTTP-header
+        Count = HeaderCount + Response->Transmit(Socket, Content, HTTPBytesSent[Socket] +
+          HeaderCount - HTTPHeaderSize[Socket], Count - HeaderCount);  // xfer header
+        HTTPBytesSent[Socket] += Count;                                // and body
+
+        if (HTTPBytesSent[Socket] == HTTPHeaderSize[Socket] + BodySize)
+          if (!(HTTPRequest[Socket].Flags & HTTP_KEEP_ALIVE))
+            TCPClose();                          // all data sent, close connection
+      }
+    }
+
+    if (HTTPRequest[Socket].Flags & HTTP_KEEP_ALIVE)
+      if (HTTPHeaderSize[Socket] && (HTTPBytesSent[Socket] == HTTPHeaderSize[Socket] + BodySize))
+        if (!TCPTxInFlight && !TCPTxRewind)      // all data sent and ACKed? then
         {
-          memcpy(TCP_TX_BUF, GetResponse, sizeof(GetResponse) - 1);
-          memcpy(TCP_TX_BUF + sizeof(GetResponse) - 1, PWebSide,
-            MAX_TCP_TX_DATA_SIZE - sizeof(GetResponse) + 1);
-          HTTPBytesToSend -= MAX_TCP_TX_DATA_SIZE - sizeof(GetResponse) + 1;
-          PWebSide += MAX_TCP_TX_DATA_SIZE - sizeof(GetResponse) + 1;
+          HTTPStatus[Socket] &= ~HTTP_SEND_PAGE; // wait for the next request
+          HistoryRelease(Socket);
         }
+  }
+  else
+  {
+    HTTPStatus[Socket] &= ~HTTP_SEND_PAGE;       // reset help-flag if not connected
+    HTTPResetParser(&HTTPParser[Socket]);        // and wait for a new request
+    HistoryRelease(Socket);
+  }
+}
+//------------------------------------------------------------------------------
+// receive handler of the HTTP sockets (see 'TCPRxHandler'): feeds the
+// request straight from the CS8900 to HTTPParse() in small pieces, so it
+// may be split across any nr. of segments w/o being buffered. what
+// follows a complete request that isn't answered yet (pipelining) is
+// skipped, so the connection is closed after the response and the
+// client sends the rest again.
+//------------------------------------------------------------------------------
+static void HTTPReceive(unsigned char Socket, unsigned int Count)
+{
+  THTTPParser *Parser = &HTTPParser[Socket];
+  unsigned int Buffer[8];                        // (word-aligned, read faster)
+  unsigned char *pData;
+  unsigned int Size;
+
+  if (Count == TCP_RX_CORRUPTED)                 // the last segment was corrupted,
+  {                                              // parse it again when it's resent
+    *Parser = HTTPParserSaved;
+    return;
+  }
+
+  HTTPParserSaved = *Parser;
+
+  while (Parser->State != HTTP_PARSE_DONE)
+  {
+    Size = TCPReadRx(Buffer, sizeof Buffer);
+    if (!Size) break;                            // end of the segment
+
+    for (pData = (unsigned char *)Buffer; Size; Size--)
+      HTTPParse(Parser, *pData++);
+  }
+
+  if (TCPReadRx(Buffer, 1))                      // (only if the request is complete)
+    Parser->Flags &= ~HTTP_KEEP_ALIVE;           // rest of the segment is lost
+}
+//------------------------------------------------------------------------------
+// takes the next char 'c' of a request. the method, the path, the version
+// and the names and values of the header fields we are interested in are
+// looked up char by char (see HTTPMatch()), the rest is skipped up to the
+// empty line that ends the request.
+//------------------------------------------------------------------------------
+static void HTTPParse(THTTPParser *Parser, unsigned char c)
+{
+  if (!c) c = 0xff;                              // (0 ends the names in HTTPMatch())
+
+  switch (Parser->State)
+  {
+    case HTTP_PARSE_METHOD :
+      if (c == ' ')                              // end of the method
+      {
+        Parser->Method = HTTPMatch(Parser->Candidates, Parser->Pos, 0, HTTP_MATCH_METHOD);
+        Parser->Candidates = HTTP_ALL(HTTP_ROUTES);  // all routes match so far
+        Parser->Pos = 0;
+        Parser->State = HTTP_PARSE_PATH;
+      }
+      else if (c == '\n')                        // empty lines in front of the request
+      {                                          // line are ignored (RFC 7230, 3.5)
+        if (Parser->Pos) Parser->State = HTTP_PARSE_DONE;
+      }
+      else if (c != '\r')
+      {
+        Parser->Candidates = HTTPMatch(Parser->Candidates, Parser->Pos, c, HTTP_MATCH_METHOD);
+        if (Parser->Pos < 0xff) Parser->Pos++;
+      }
+      break;
+    case HTTP_PARSE_PATH :
+      if ((c != ' ') && (c != '?') && (c != '\r') && (c != '\n'))
+      {
+        Parser->Candidates = HTTPMatch(Parser->Candidates, Parser->Pos, c, HTTP_MATCH_PATH);
+        if (Parser->Pos < 0xff) Parser->Pos++;
+        break;
+      }
+      Parser->Route = HTTPFirst(HTTPMatch(Parser->Candidates, Parser->Pos, 0,
+        HTTP_MATCH_PATH));                       // end of the path
+      Parser->State = HTTP_PARSE_QUERY;
+      if (c == '?') break;
+      // no break, the char ends the query, too
+    case HTTP_PARSE_QUERY :
+      if (c == ' ')                              // the version follows
+      {
+        Parser->Candidates = HTTP_ALL(HTTP_VERSIONS);
+        Parser->Pos = 0;
+        Parser->State = HTTP_PARSE_VERSION;
+      }
+      else if ((c == '\r') || (c == '\n'))       // no version, so there is no header
+      {                                          // either (HTTP/0.9)
+        Parser->Flags |= HTTP_SIMPLE;
+        Parser->State = (c == '\n') ? HTTP_PARSE_DONE : HTTP_PARSE_LINE;
+      }
+      break;
+    case HTTP_PARSE_VERSION :
+      if ((c == '\r') || (c == '\n'))            // end of the request line
+      {
+        if (HTTPFirst(HTTPMatch(Parser->Candidates, Parser->Pos, 0, HTTP_MATCH_VERSION)) ==
+          HTTP_VERSION_1_1)
+          Parser->Flags |= HTTP_KEEP_ALIVE;      // persistent by default (RFC 7230, 6.3)
+        Parser->Pos = 0;
+        Parser->State = (c == '\n') ? HTTP_PARSE_HEADER : HTTP_PARSE_LINE;
+      }
+      else
+      {
+        Parser->Candidates = HTTPMatch(Parser->Candidates, Parser->Pos, c, HTTP_MATCH_VERSION);
+        if (Parser->Pos < 0xff) Parser->Pos++;
+      }
+      break;
+    case HTTP_PARSE_LINE :
+      if (c == '\n')
+        Parser->State = (Parser->Flags & HTTP_SIMPLE) ? HTTP_PARSE_DONE : HTTP_PARSE_HEADER;
+      break;
+    case HTTP_PARSE_HEADER :
+      if (!Parser->Pos)                          // a new line, all names match so far
+        Parser->Candidates = HTTP_ALL(HTTP_HEADERS);
+
+      if (c == '\n')                             // an empty line ends the request
+      {                                          // (one w/o ':' is ignored)
+        if (!Parser->Pos) Parser->State = HTTP_PARSE_DONE;
+        Parser->Pos = 0;
+      }
+      else if (c == ':')                         // end of the name
+      {
+        Parser->Header = HTTPFirst(HTTPMatch(Parser->Candidates, Parser->Pos, 0,
+          HTTP_MATCH_HEADER));
+        Parser->Pos = 0;
+        if (Parser->Header == HTTP_NO_MATCH)
+          Parser->State = HTTP_PARSE_SKIP;
         else
         {
-          memcpy(TCP_TX_BUF, PWebSide, MAX_TCP_TX_DATA_SIZE);
-          HTTPBytesToSend -= MAX_TCP_TX_DATA_SIZE;
-          PWebSide += MAX_TCP_TX_DATA_SIZE;
+          Parser->Candidates = HTTP_ALL(HTTPTokens[Parser->Header]);
+          Parser->State = HTTP_PARSE_VALUE;
+        }
+      }
+      else if (c != '\r')
+      {
+        Parser->Candidates = HTTPMatch(Parser->Candidates, Parser->Pos, c, HTTP_MATCH_HEADER);
+        if (Parser->Pos < 0xff) Parser->Pos++;
+      }
+      break;
+    case HTTP_PARSE_VALUE :                      // list of tokens
+      if ((c == ',') || (c == ';') || (c == ' ') || (c == '\t') || (c == '\r') ||
+          (c == '\n'))
+      {
+        if (Parser->Pos)
+        {
+          if (!(Parser->Flags & HTTP_QVALUE))    // end of a token...
+            HTTPToken(Parser, HTTPFirst(HTTPMatchValue(Parser, 0)));
+          else if (Parser->Candidates && (Parser->Pos >= 3))
+            Parser->Flags &= ~HTTP_GZIP;         // ...or of a parameter 'q=0' of 'gzip'
+          Parser->Candidates = 0;                // ignore the rest (parameters) up to
+          Parser->Pos = 0;                       // the next ','
+        }
+        if ((c == ',') || (c == '\n'))
+        {
+          Parser->Candidates = HTTP_ALL(HTTPTokens[Parser->Header]);
+          Parser->Flags &= ~HTTP_QVALUE;
         }
-          
-        TCPTxDataCount = MAX_TCP_TX_DATA_SIZE;   // bytes to xfer
-        InsertDynamicValues();                   // exchange some strings...
-        TCPTransmitTxBuffer();                   // xfer buffer
+        if (c == '\n') Parser->State = HTTP_PARSE_HEADER;
+      }
+      else if (Parser->Flags & HTTP_QVALUE)     // parameter of 'gzip'
+      {
+        if (!Parser->Pos) Parser->Candidates = 1;
+        Parser->Candidates = HTTPMatch(Parser->Candidates, Parser->Pos, c, HTTP_MATCH_QVALUE);
+        if (Parser->Pos < 0xff) Parser->Pos++;
       }
-      else if (HTTPBytesToSend)                  // transmit leftover bytes
+      else
       {
-        memcpy(TCP_TX_BUF, PWebSide, HTTPBytesToSend);
-        TCPTxDataCount = HTTPBytesToSend;        // bytes to xfer
-        InsertDynamicValues();                   // exchange some strings...
-        TCPTransmitTxBuffer();                   // send last segment
-        TCPClose();                              // and close connection
-        HTTPBytesToSend = 0;                     // all data sent
+        Parser->Candidates = HTTPMatchValue(Parser, c);
+        if (Parser->Pos < 0xff) Parser->Pos++;
       }
+      break;
+    case HTTP_PARSE_SKIP :
+      if (c == '\n')
+      {
+        Parser->Pos = 0;
+        Parser->State = HTTP_PARSE_HEADER;
+      }
+      break;
+  }
+}
+//------------------------------------------------------------------------------
+// takes the token 'Token' of the header field the parser is in
+// ('HTTP_CONNECTION_CLOSE'... or 'HTTP_NO_MATCH'). the parameters of 'gzip'
+// are looked at for a q-value of 0, which refuses it (RFC 7231, 5.3.4).
+//------------------------------------------------------------------------------
+static void HTTPToken(THTTPParser *Parser, unsigned char Token)
+{
+  switch (Parser->Header)
+  {
+    case HTTP_HEADER_CONNECTION :
+      if (Token == HTTP_CONNECTION_CLOSE)
+        Parser->Flags &= ~HTTP_KEEP_ALIVE;
+      else if (Token == HTTP_CONNECTION_KEEP_ALIVE)  // (HTTP/1.0 clients)
+        Parser->Flags |= HTTP_KEEP_ALIVE;
+      break;
+    case HTTP_HEADER_ACCEPT_ENCODING :
+      if (Token == HTTP_ENCODING_GZIP)
+        Parser->Flags |= HTTP_GZIP | HTTP_QVALUE;
+      break;
+    case HTTP_HEADER_IF_NONE_MATCH :
+      if (Token == HTTP_ETAG_IDENTITY)
+        Parser->Flags |= HTTP_IDENTITY_CACHED;
+      else if (Token == HTTP_ETAG_GZIP)
+        Parser->Flags |= HTTP_GZIP_CACHED;
+      else if (Token == HTTP_ETAG_ANY)
+        Parser->Flags |= HTTP_IDENTITY_CACHED | HTTP_GZIP_CACHED;
+      break;
+  }
+}
+//------------------------------------------------------------------------------
+// compares the char 'c' at position 'Pos' of a token with the names of the
+// table 'Table' ('HTTP_MATCH_...') whose bits are set in 'Candidates' and
+// returns the bits of those that still match. 'c' = 0 at the end of the
+// token keeps the names that end there.
+//------------------------------------------------------------------------------
+static unsigned int HTTPMatch(unsigned int Candidates, unsigned char Pos, unsigned char c,
+  unsigned char Table)
+{
+  unsigned char i;
+  const char *Name;
 
-      HTTPStatus |= HTTP_SEND_PAGE;              // ok, 1st loop executed
+  if ((Table >= HTTP_MATCH_HEADER) && (c >= 'A') && (c <= 'Z'))
+    c += 'a' - 'A';                              // names of header fields and tokens
+                                                 // ignore the case
+  for (i = 0; (i < 16) && (Candidates >> i); i++)
+    if (Candidates & ((unsigned int)1 << i))
+    {
+      Name = (Table == HTTP_MATCH_PATH) ? HTTPRoutes[i].Path : HTTPNames[Table][i];
+      if ((unsigned char)Name[Pos] != c)
+        Candidates &= ~((unsigned int)1 << i);
     }
-  }
-  else
-    HTTPStatus &= ~HTTP_SEND_PAGE;               // reset help-flag if not connected
+
+  return Candidates;
 }
 //------------------------------------------------------------------------------
-// samples and returns the AD-converter value of channel 7
-// (associated with Port P6.7)
+// HTTPMatch() for the char 'c' of a token in the value of the header field
+// the parser is in. the tokens of 'If-None-Match' are the entity tags of the
+// body of the route and of its gzip encoding, and '*' (case-sensitive, weak
+// tags 'W/"..."' don't match as we only hand out strong ones).
 //------------------------------------------------------------------------------
-static unsigned int GetAD7Val(void)
+static unsigned int HTTPMatchValue(const THTTPParser *Parser, unsigned char c)
 {
-  ADC12MCTL0 = SREF_1 + INCH_7;                  // Select channel 7, Vref+
-  
-  ADC12CTL0 |= ENC;                              // enable conversion
-  ADC12CTL0 |= ADC12SC;                          // sample & convert
-  
-  while (ADC12CTL0 & ADC12SC);                   // wait until conversion is complete
-  
-  ADC12CTL0 &= ~ENC;                             // disable conversion
+  unsigned int Candidates = Parser->Candidates;
+  const char *Name;
+  unsigned char i;
+
+  if (Parser->Header != HTTP_HEADER_IF_NONE_MATCH)
+    return HTTPMatch(Candidates, Parser->Pos, c, HTTP_MATCH_CONNECTION + Parser->Header);
 
-  return ADC12MEM0 >> 5;                         // Scale value
+  if (Parser->Route == HTTP_NO_MATCH)            // (nothing to compare with)
+    return 0;
+
+  for (i = 0; i < HTTP_ETAG_TOKENS; i++)
+    if (Candidates & ((unsigned int)1 << i))
+    {
+      if (i == HTTP_ETAG_ANY)
+        Name = "*";
+      else if (i == HTTP_ETAG_GZIP)
+        Name = HTTPRoutes[Parser->Route].Gzip.ETag;
+      else
+        Name = HTTPRoutes[Parser->Route].Identity.ETag;
+
+      if (!Name || ((unsigned char)Name[Parser->Pos] != c))
+        Candidates &= ~((unsigned int)1 << i);
+    }
+
+  return Candidates;
 }
 //------------------------------------------------------------------------------
-// samples and returns AD-converter value of channel 10
-// (MSP430 internal temperature reference diode)
+// returns the index of the first name in 'Candidates' (see HTTPMatch()) or
+// 'HTTP_NO_MATCH'
 //------------------------------------------------------------------------------
-static unsigned int GetTempVal(void)
+static unsigned char HTTPFirst(unsigned int Candidates)
 {
-  unsigned int i;
-  unsigned int ADCResult;
+  unsigned char i;
 
-  ADC12MCTL0 = SREF_1 + INCH_10;                 // Select channel A10, Vref+
+  for (i = 0; i < 16; i++)
+    if (Candidates & ((unsigned int)1 << i))
+      return i;
 
-  ADC12CTL0 |= ENC;                              // enable conversion
-  ADC12CTL0 |= ADC12SC;                          // sample & convert
-  
-  while (ADC12CTL0 & ADC12SC);                   // wait until conversion is complete
-  
-  ADC12CTL0 &= ~ENC;                             // disable conversion
+  return HTTP_NO_MATCH;
+}
+//------------------------------------------------------------------------------
+// prepares the parser of a socket for a new request
+//------------------------------------------------------------------------------
+static void HTTPResetParser(THTTPParser *Parser)
+{
+  Parser->State = HTTP_PARSE_METHOD;
+  Parser->Pos = 0;
+  Parser->Method = 0;
+  Parser->Route = HTTP_NO_MATCH;
+  Parser->Flags = 0;
+  Parser->Candidates = HTTP_ALL(HTTP_METHODS);   // all methods match so far
+}
+//------------------------------------------------------------------------------
+// returns the response to a complete request: the route of its path, or
+// an error if there is none or it doesn't allow the method
+//------------------------------------------------------------------------------
+static const THTTPRoute *HTTPDispatch(const THTTPParser *Parser)
+{
+  if (Parser->Route == HTTP_NO_MATCH)
+    return &HTTPNotFound;
+
+  if (!(HTTPRoutes[Parser->Route].Methods & Parser->Method))
+    return &HTTPNotAllowed;
+
+  return &HTTPRoutes[Parser->Route];
+}
+//------------------------------------------------------------------------------
+// writes the HTTP-header of the response of 'Socket' to TCP_TX_BUF and
+// returns its size (max. 'HTTP_MAX_HEADER_SIZE'). it is built again if the
+// stack wants a part of it again, so it must not change.
+//------------------------------------------------------------------------------
+static unsigned char HTTPWriteHeader(unsigned char Socket)
+{
+  const THTTPRoute *Response = HTTPResponse[Socket];
+  const THTTPContent *Content = HTTPContent[Socket];
+  const THTTPParser *Request = &HTTPRequest[Socket];
+  char *Header = (char *)TCP_TX_BUF;
+  const char *Separator = " ";
+  unsigned int Count;
+  unsigned char i;
+
+  if (HTTPStatus[Socket] & HTTP_NOT_MODIFIED)    // no body, so no 'Content-...' fields
+    Count = sprintf(Header, "HTTP/1.1 %s\r\n", HTTP_304);
+  else
+  {
+    Count = sprintf(Header, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n",
+      Response->Status, Response->Type, HTTPBodySize[Socket]);
+    if (Content == &Response->Gzip)
+      Count += sprintf(Header + Count, "Content-Encoding: gzip\r\n");
+  }
+
+  Count += sprintf(Header + Count, "Connection: %s\r\n",
+    (Request->Flags & HTTP_KEEP_ALIVE) ? "keep-alive" : "close");
+
+  if (Response->Gzip.Data)                       // body depends on 'Accept-Encoding'
+    Count += sprintf(Header + Count, "Vary: Accept-Encoding\r\n");
+  if (Content->ETag)
+    Count += sprintf(Header + Count, "ETag: %s\r\n", Content->ETag);
+  if (Response->Cache)
+    Count += sprintf(Header + Count, "Cache-Control: %s\r\n", Response->Cache);
+
+  if (Response == &HTTPNotAllowed)               // list the methods the resource allows
+  {
+    Count += sprintf(Header + Count, "Allow:");
+    for (i = 0; i < HTTP_METHODS; i++)
+      if (HTTPRoutes[Request->Route].Methods & (1 << i))
+      {
+        Count += sprintf(Header + Count, "%s%s", Separator, HTTPMethodName[i]);
+        Separator = ", ";
+      }
+    Count += sprintf(Header + Count, "\r\n");
+  }
 
-  ADCResult = ADC12MEM0;                         // Read out ADC12 value
+  Count += sprintf(Header + Count, "\r\n");      // end of HTTP-header
+  return Count;
+}
+//------------------------------------------------------------------------------
+// returns the scaled AD-converter value of channel 7
+// (associated with Port P6.7)
+//------------------------------------------------------------------------------
+static unsigned int GetAD7Val(unsigned int ADCResult)
+{
+  return ADCResult >> 5;                         // Scale value
+}
+//------------------------------------------------------------------------------
+// returns the scaled AD-converter value of channel 10
+// (MSP430 internal temperature reference diode)
+//------------------------------------------------------------------------------
+static unsigned int GetTempVal(unsigned int ADCResult)
+{
+  unsigned int i;
 
   for (i = 0; i < sizeof Temp_Tab; i++)          // Get temperature value out
     if (ADCResult < Temp_Tab[i])                 // of table
@@ -249,36 +800,412 @@ static unsigned int GetTempVal(void)
   return i << 1;                                 // Scale value
 }
 //------------------------------------------------------------------------------
-// searches the TX-buffer for special strings and replaces them
-// with dynamic values (AD-converter results)
+// prepares sending 'Content' and returns its size. the dynamic values are
+// sampled once, so each retransmission shows the same ones (and the CRC-32
+// of a gzip body fits).
 //------------------------------------------------------------------------------
-static void InsertDynamicValues(void)
+static unsigned int BeginContent(unsigned char Socket, const THTTPContent *Content)
 {
-  char *Key;
-  char NewKey[5];
-  int i;
-  
-  if (TCPTxDataCount < 4) return;                // there can't be any special string
-  
-  Key = (char *)TCP_TX_BUF;
-  
-  for (i = 0; i < TCPTxDataCount - 3; i++)
+  if (Content->Index)
+  {
+    HTTPValues[Socket][WEB_VALUE_AD7] = GetAD7Val(ADCSamples[ADC_AD7]);    // channel 7 (P6.7)
+    HTTPValues[Socket][WEB_VALUE_TEMP] = GetTempVal(ADCSamples[ADC_TEMP]); // temp.-diode
+  }
+
+  return Content->Size;
+}
+//------------------------------------------------------------------------------
+// transmits up to 'Count' bytes of 'Content' from offset 'Ofs' on behind the
+// data in TCP_TX_BUF and returns the nr. of bytes taken. the placeholders are
+// looked up in 'Content->Index' and replaced with the values sampled for the
+// response (AD-converter results, CRC-32 of a gzip body) in TCP_TX_BUF. the
+// static parts in between are copied there, too, as long as the next value
+// fits into the segment. the last one is sent straight from flash. so a
+// segment never ends inside a value, unless the stack asks for a value again
+// from the middle ('TCPTxRewind').
+//------------------------------------------------------------------------------
+static unsigned int TransmitContent(unsigned char Socket, const THTTPContent *Content,
+  unsigned int Ofs, unsigned int Count)
+{
+  const TWebPlaceholder *Value = Content->Index;
+  char Text[WEB_MAX_VALUE_WIDTH + 1];
+  unsigned int Start = Ofs;
+  unsigned int End = Start + Count;              // where the segment ends
+  unsigned int Next;
+
+  if (!Value)                                    // static content: all of it
+  {                                              // straight from flash
+    TCPTransmitConst(Content->Data + Ofs, Count);
+    return Count;
+  }
+
+  while (Value->Ofs + Value->Width <= Ofs)       // skip the values in front of 'Ofs'
+    Value++;                                     // (the table ends with 0xffff)
+
+  while (1)
+  {
+    if (Value->Ofs <= Ofs)                       // (rest of) a value to insert?
+    {
+      Next = Value->Ofs + Value->Width;
+      if (Next > End) Next = End;
+      TCPWriteTxBuffer(GetContentValue(Socket, Content, Value, Text) + (Ofs - Value->Ofs),
+        Next - Ofs);
+      Ofs = Next;
+      Value++;
+    }
+
+    Next = (Value->Ofs < End) ? Value->Ofs : End;  // static part up to the next value
+    if ((Next == End) || (Value->Ofs + Value->Width > End) ||
+        (Next - Ofs + Value->Width > TCP_TX_BUF_SIZE - TCPTxDataCount))
+      break;                                     // last part of this segment?
+
+    TCPWriteTxBuffer(Content->Data + Ofs, Next - Ofs);
+    Ofs = Next;
+  }
+
+  TCPTransmitConst(Content->Data + Ofs, Next - Ofs);
+  return Next - Start;
+}
+//------------------------------------------------------------------------------
+// writes the value of the placeholder 'Value' of 'Content' to 'Text'
+// ('WEB_MAX_VALUE_WIDTH' + 1 chars) and returns where its 'Value->Width'
+// chars start. numbers are right-aligned, the CRC-32 is little endian.
+//------------------------------------------------------------------------------
+static const char *GetContentValue(unsigned char Socket, const THTTPContent *Content,
+  const TWebPlaceholder *Value, char *Text)
+{
+  unsigned long CRC;
+  unsigned char i;
+
+  if (Value->Value == WEB_VALUE_CRC32)
+  {
+    CRC = GetContentCRC(Socket, Content, Value);
+    for (i = 0; i < 4; i++)
+    {
+      Text[i] = (char)CRC;
+      CRC >>= 8;
+    }
+    return Text;
+  }
+
+  sprintf(Text, "%5u", HTTPValues[Socket][Value->Value]);  // ('WEB_MAX_VALUE_WIDTH')
+  return Text + WEB_MAX_VALUE_WIDTH - Value->Width;
+}
+//------------------------------------------------------------------------------
+// returns the CRC-32 of the gzip body 'Content' with the values of the
+// response. 'Trailer->CRC' is the one of the template page, it's corrected
+// for each value that differs from the template: the CRC of the difference
+// (w/o pre- and post-conditioning) is moved over the bytes behind the value
+// by a multiplication with 'Value->CRC' (x^(8 * bytes) mod P).
+//------------------------------------------------------------------------------
+static unsigned long GetContentCRC(unsigned char Socket, const THTTPContent *Content,
+  const TWebPlaceholder *Trailer)
+{
+  const TWebPlaceholder *Value;
+  const char *Text;
+  char Buffer[WEB_MAX_VALUE_WIDTH + 1];
+  unsigned long CRC = Trailer->CRC;
+  unsigned long Diff;
+  unsigned char i;
+
+  for (Value = Content->Index; Value < Trailer; Value++)
+  {
+    Text = GetContentValue(Socket, Content, Value, Buffer);
+    Diff = 0;
+    for (i = 0; i < Value->Width; i++)
+      Diff = CRC32AddByte(Diff, Text[i] ^ Content->Data[Value->Ofs + i]);
+    if (Diff)
+      CRC ^= CRC32MulMod(Diff, Value->CRC);
+  }
+
+  return CRC;
+}
+//------------------------------------------------------------------------------
+// adds the byte 'c' to 'CRC' (CRC-32 of gzip, reflected, bitwise)
+//------------------------------------------------------------------------------
+static unsigned long CRC32AddByte(unsigned long CRC, unsigned char c)
+{
+  unsigned char i;
+
+  CRC ^= c;
+  for (i = 0; i < 8; i++)
+    CRC = (CRC & 1) ? (CRC >> 1) ^ CRC32_POLY : CRC >> 1;
+
+  return CRC;
+}
+//------------------------------------------------------------------------------
+// returns a * b modulo the CRC-32 polynomial (bit-reflected, x^0 = 0x80000000)
+//------------------------------------------------------------------------------
+static unsigned long CRC32MulMod(unsigned long a, unsigned long b)
+{
+  unsigned long m = 0x80000000ul;
+  unsigned long p = 0;
+
+  while (m)
+  {
+    if (a & m)
+    {
+      p ^= b;
+      if (!(a & (m - 1))) break;                 // no more bits set in 'a'
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ CRC32_POLY : b >> 1;
+  }
+
+  return p;
+}
+//------------------------------------------------------------------------------
+// prepares sending the history as it is now: its blocks up to the bytes
+// used in the newest one. they don't change anymore, only the oldest one
+// could be reused by HistoryAdd(), so it is kept until the response is
+// complete (see HistoryRelease()). returns the size of the body.
+//------------------------------------------------------------------------------
+static unsigned int BeginHistory(unsigned char Socket, const THTTPContent *Content)
+{
+  unsigned int Size = 0;
+
+  __disable_interrupt();                         // (ADC12Handler() adds samples)
+
+  if (HistoryBlocks)
+  {
+    HistoryFirst[Socket] = HistoryNewest - HistoryBlocks + 1;
+    HistoryPins |= 1 << Socket;
+    Size = (HistoryBlocks - 1) * HISTORY_BLOCK_SIZE + HistoryLength;
+  }
+
+  __enable_interrupt();
+
+  return Size;
+}
+//------------------------------------------------------------------------------
+// transmits up to 'Count' bytes of the history from offset 'Ofs' on behind
+// the data in TCP_TX_BUF and returns the nr. of bytes taken. the blocks are
+// sent straight from RAM, a segment that wraps around the end of the ring
+// copies the end of the ring to TCP_TX_BUF (if it fits).
+//------------------------------------------------------------------------------
+static unsigned int TransmitHistory(unsigned char Socket, const THTTPContent *Content,
+  unsigned int Ofs, unsigned int Count)
+{
+  unsigned char Block = (HistoryFirst[Socket] + Ofs / HISTORY_BLOCK_SIZE) & (HISTORY_BLOCKS - 1);
+  const unsigned char *Data = HistoryRing[Block] + Ofs % HISTORY_BLOCK_SIZE;
+  unsigned int ToEnd = (const unsigned char *)HistoryRing + sizeof HistoryRing - Data;
+  unsigned int Taken = 0;
+
+  if ((ToEnd < Count) && (ToEnd <= TCP_TX_BUF_SIZE - TCPTxDataCount))
   {
-    if (*Key == 'A')
-     if (*(Key + 1) == 'D')
-       if (*(Key + 3) == '%')
-         if (*(Key + 2) == '7')                  // "AD7%"?
-         {
-           sprintf(NewKey, "%3u", GetAD7Val());  // insert AD converter value
-           memcpy(Key, NewKey, 3);               // channel 7 (P6.7)
-         }
-         else if (*(Key + 2) == 'A')
-         {
-           sprintf(NewKey, "%3u", GetTempVal()); // insert AD converter value
-           memcpy(Key, NewKey, 3);               // channel 10 (temp.-diode)
-         }
-    Key++;
+    TCPWriteTxBuffer(Data, ToEnd);               // end of the ring...
+    Data = HistoryRing[0];                       // ...the rest from its start
+    Taken = ToEnd;
+    Count -= ToEnd;
+    ToEnd = sizeof HistoryRing;
   }
+
+  if (Count > ToEnd) Count = ToEnd;
+  TCPTransmitConst(Data, Count);
+  return Taken + Count;
+}
+//------------------------------------------------------------------------------
+// prepares sending the current readings: the ADC12 results are sampled
+// once (w/o being changed in between by ADC12Handler()), so each
+// retransmission shows the same ones. returns the size of the body.
+//------------------------------------------------------------------------------
+static unsigned int BeginValues(unsigned char Socket, const THTTPContent *Content)
+{
+  char Text[VALUES_MAX_SIZE];
+  unsigned char i;
+
+  __disable_interrupt();
+  for (i = 0; i < ADC_CHANNELS; i++)
+    HTTPSamples[Socket][i] = ADCSamples[i];
+  __enable_interrupt();
+
+  HTTPValues[Socket][WEB_VALUE_AD7] = GetAD7Val(HTTPSamples[Socket][ADC_AD7]);
+  HTTPValues[Socket][WEB_VALUE_TEMP] = GetTempVal(HTTPSamples[Socket][ADC_TEMP]);
+
+  return GetValuesText(Socket, Text);
+}
+//------------------------------------------------------------------------------
+// transmits up to 'Count' bytes of the current readings from offset 'Ofs'
+// on behind the data in TCP_TX_BUF and returns the nr. of bytes taken. the
+// body is small enough to be built again for each segment.
+//------------------------------------------------------------------------------
+static unsigned int TransmitValues(unsigned char Socket, const THTTPContent *Content,
+  unsigned int Ofs, unsigned int Count)
+{
+  char Text[VALUES_MAX_SIZE];
+
+  GetValuesText(Socket, Text);
+  TCPWriteTxBuffer(Text + Ofs, Count);
+  TCPTransmitTxBuffer();
+  return Count;
+}
+//------------------------------------------------------------------------------
+// writes the readings sampled for the response of 'Socket' to 'Text'
+// ('VALUES_MAX_SIZE' chars) and returns their length
+//------------------------------------------------------------------------------
+static unsigned int GetValuesText(unsigned char Socket, char *Text)
+{
+  return sprintf(Text, VALUES_FORMAT, HTTPValues[Socket][WEB_VALUE_AD7],
+    HTTPValues[Socket][WEB_VALUE_TEMP], HTTPSamples[Socket][ADC_AD7],
+    HTTPSamples[Socket][ADC_TEMP]);
+}
+//------------------------------------------------------------------------------
+// adds the latest samples to the telemetry batch being filled (called by
+// ADC12Handler() each 'TELEMETRY_PERIOD'). returns 1 if TelemetryPoll()
+// has to run: the batch is complete, then the other one is filled (if
+// that one hasn't been sent yet, the new batch is dropped), or a batch
+// waiting for the MAC of the collector is to be sent again.
+//------------------------------------------------------------------------------
+static unsigned char TelemetryAdd(void)
+{
+  unsigned int *Batch = TelemetryBatch[TelemetryFill];
+  unsigned char Wakeup = 0;
+  unsigned char i;
+
+  if (TelemetryReady == TELEMETRY_WAIT_MAC)
+  {
+    TelemetryReady = TELEMETRY_RETRY;
+    Wakeup = 1;
+  }
+
+  if (!TelemetryCount)
+    Batch[0] = TelemetryTime;                    // nr. of the 1st sample
+
+  Batch += TELEMETRY_HEADER_SIZE / 2 + TelemetryCount * ADC_CHANNELS;
+  for (i = 0; i < ADC_CHANNELS; i++)
+    Batch[i] = ADCSamples[i];
+  TelemetryTime++;
+
+  if (++TelemetryCount < TELEMETRY_BATCH)
+    return Wakeup;
+
+  TelemetryCount = 0;
+  if (TelemetryReady)                            // main loop is behind (TX path busy)?
+  {
+    TelemetryDropped++;
+    return Wakeup;
+  }
+
+  TelemetryReady = TELEMETRY_READY;
+  TelemetryFill ^= 1;
+  return 1;
+}
+//------------------------------------------------------------------------------
+// sends the last complete telemetry batch to the collector, if there is
+// one. the main loop never waits for it: if the MAC of the collector isn't
+// known (the ARP cache expires even while it is used, see UDPSendTo()),
+// the batch is tried once more with the next sample, else it is dropped
+// if it can't be passed to the CS8900 at once.
+//------------------------------------------------------------------------------
+static void TelemetryPoll(void)
+{
+  unsigned int *Batch;
+  unsigned char Result;
+
+  if (!TelemetryReady || (TelemetryReady == TELEMETRY_WAIT_MAC))
+    return;
+
+  Batch = TelemetryBatch[TelemetryFill ^ 1];     // (not switched while 'TelemetryReady')
+  Batch[1] = TelemetryDropped;
+  Result = UDPSendTo(TELEMETRY_SOCKET, TelemetryIP, TELEMETRY_PORT, Batch, TELEMETRY_SIZE);
+
+  if ((Result == UDP_ERR_ARP_PENDING) && (TelemetryReady == TELEMETRY_READY))
+  {
+    TelemetryReady = TELEMETRY_WAIT_MAC;         // wait for the ARP-reply
+    return;
+  }
+
+  if (Result != UDP_SENT)
+  {
+    __disable_interrupt();                       // (ADC12Handler() counts, too)
+    TelemetryDropped++;
+    __enable_interrupt();
+  }
+
+  TelemetryReady = 0;
+}
+//------------------------------------------------------------------------------
+// adds the latest samples to the history (called by ADC12Handler() each
+// 'HISTORY_PERIOD'). they are appended to the newest block as differences
+// to the last sample, or start a new block if they don't fit. if that would
+// reuse a block a download still needs, the sample is dropped.
+//------------------------------------------------------------------------------
+static void HistoryAdd(void)
+{
+  unsigned char Code[2 * ADC_CHANNELS];          // differences, max. 2 bytes each
+  unsigned char Size = 0;
+  unsigned char *Block;
+  unsigned char i;
+  int Diff;
+
+  if (HistoryBlocks)
+    for (i = 0; i < ADC_CHANNELS; i++)
+    {
+      Diff = ADCSamples[i] - HistoryLast[i];
+      if ((Diff >= -64) && (Diff < 64))
+        Code[Size++] = Diff & 0x7f;
+      else
+      {
+        Code[Size++] = 0x80 | ((Diff >> 8) & 0x3f);
+        Code[Size++] = Diff;
+      }
+    }
+
+  if (HistoryBlocks && (HistoryLength + Size <= HISTORY_BLOCK_SIZE))
+  {
+    memcpy(HistoryRing[HistoryNewest & (HISTORY_BLOCKS - 1)] + HistoryLength, Code, Size);
+    HistoryLength += Size;
+  }
+  else                                           // start a new block
+  {
+    if ((HistoryBlocks == HISTORY_BLOCKS) && HistoryPinned(HistoryNewest + 1 - HISTORY_BLOCKS))
+    {
+      HistoryLength = HISTORY_BLOCK_SIZE;        // the newest one is complete,
+      HistoryTime++;                             // the next sample starts a new one
+      return;
+    }
+
+    if (HistoryBlocks) HistoryNewest++;
+    if (HistoryBlocks < HISTORY_BLOCKS) HistoryBlocks++;
+
+    Block = HistoryRing[HistoryNewest & (HISTORY_BLOCKS - 1)];
+    memset(Block, 0xff, HISTORY_BLOCK_SIZE);     // (end of block codes)
+    Block[0] = HistoryTime;
+    Block[1] = HistoryTime >> 8;
+    for (i = 0; i < ADC_CHANNELS; i++)
+    {
+      Block[2 + 2 * i] = ADCSamples[i];
+      Block[3 + 2 * i] = ADCSamples[i] >> 8;
+    }
+    HistoryLength = HISTORY_HEADER_SIZE;
+  }
+
+  for (i = 0; i < ADC_CHANNELS; i++)
+    HistoryLast[i] = ADCSamples[i];
+  HistoryTime++;
+}
+//------------------------------------------------------------------------------
+// returns 1 if the block with the serial nr. 'Block' is part of a download
+// that isn't complete yet
+//------------------------------------------------------------------------------
+static unsigned char HistoryPinned(unsigned int Block)
+{
+  unsigned char i;
+
+  for (i = 0; i < TCP_MAX_SOCKETS; i++)
+    if (HistoryPins & (1 << i))
+      if ((unsigned int)(Block - HistoryFirst[i]) < HISTORY_BLOCKS)
+        return 1;
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+// the response of 'Socket' is complete (or the connection is gone), so
+// HistoryAdd() may reuse the blocks it sent
+//------------------------------------------------------------------------------
+static void HistoryRelease(unsigned char Socket)
+{
+  HistoryPins &= ~(1 << Socket);
 }
 //------------------------------------------------------------------------------
 // enables the 8MHz crystal on XT1 and use
@@ -317,13 +1244,68 @@ static void InitPorts(void)
   P6DIR = 0x7f;                                  // all output except P6.7
 }
 //------------------------------------------------------------------------------
+// starts sampling in the background: each 'ADC_SAMPLE_PERIOD' Timer_B.OUT1
+// triggers a sequence, the ADC12 converts the channels one after the other
+// and ADC12Handler() takes the results at the end of it. so nothing has to
+// wait for the converter. the reference is switched on by ADCRefHandler()
+// just in time for the sequence.
+//------------------------------------------------------------------------------
 static void InitADC12(void)
 {
-  // CHASE
-  //ADC12CTL0 = ADC12ON + REFON + REF2_5V + SHT0_6;// Turn on ADC12, 2.5Vref, set SHT0
-  //ADC12CTL1 = SHS_0 + SHP + CONSEQ_0;            // Use sampling timer, ADC12SC
-                                                 // triggers conversion,
-                                                 // single channel single conversion,
+  ADC12CTL0 = ADC12ON + REF2_5V + SHT0_6 + MSC;  // Turn on ADC12, 2.5Vref (still off),
+                                                 // set SHT0, whole sequence per trigger
+  ADC12CTL1 = SHS_3 + SHP + CONSEQ_1;            // Use sampling timer, Timer_B.OUT1
+                                                 // triggers a sequence of channels
+  ADC12MCTL0 = SREF_1 + INCH_7;                  // 'ADC_AD7': channel 7, Vref+
+  ADC12MCTL1 = SREF_1 + INCH_10 + EOS;           // 'ADC_TEMP': channel A10, Vref+,
+                                                 // end of sequence
+  ADC12IE = 1 << (ADC_CHANNELS - 1);             // int. at the end of the sequence
+
+  TBCCR0 = ADC_SAMPLE_PERIOD - 1;                // OUT1 is set at TBCCR0 and reset
+  TBCCR1 = ADC_SAMPLE_PERIOD - ADC_REF_SETTLE;   // at TBCCR1: one rising edge per
+  TBCCTL1 = OUTMOD_7 + CCIE;                     // period, int. to switch on the
+  TBCTL = TBSSEL_1 + ID_3 + TBCLR + MC_1;        // reference. ACLK / 8 = 250 kHz, up mode
+}
+//------------------------------------------------------------------------------
+// Timer_B interrupt 'ADC_REF_SETTLE' before the next sequence: switches on
+// the reference and enables the conversion (REFON can't be changed while
+// ENC is set, ENC has to be toggled for each triggered sequence anyway)
+//------------------------------------------------------------------------------
+#pragma vector = TIMERB1_VECTOR
+__interrupt void ADCRefHandler(void)
+{
+  TBCCTL1 &= ~CCIFG;
+  ADC12CTL0 |= REFON;
+  ADC12CTL0 |= ENC;
+}
+//------------------------------------------------------------------------------
+// ADC12 interrupt at the end of each sequence: keeps the results as the
+// latest samples (reading ADC12MEMx resets its int.-flag) and switches the
+// reference off up to the next one
+//------------------------------------------------------------------------------
+#pragma vector = ADC12_VECTOR
+__interrupt void ADC12Handler(void)
+{
+  ADCSamples[ADC_AD7] = ADC12MEM0;
+  ADCSamples[ADC_TEMP] = ADC12MEM1;
+  ADC12CTL0 &= ~ENC;
+  ADC12CTL0 &= ~REFON;
+
+  if (!HistoryTicks--)                           // time for the next sample of the
+  {                                              // history?
+    HistoryTicks = HISTORY_PERIOD - 1;
+    HistoryAdd();
+  }
+
+  if (TELEMETRY_PERIOD && !TelemetryTicks--)     // ...and of the telemetry?
+  {
+    TelemetryTicks = TELEMETRY_PERIOD - 1;
+    if (TelemetryAdd())                          // batch complete?
+    {
+      TCPUserEvent = 1;
+      __bic_SR_register_on_exit(LPM3_bits);      // wake up the main program
+    }
+  }
 }
 
 
@@ -12,7 +12,199 @@
 #ifndef __EASYWEB_H
 #define __EASYWEB_H
 
+#define HTTP_MAX_HEADER_SIZE         224         // HTTP-header of a response (built in
+                                                 // TCP_TX_BUF)
+#define HTTP_IDLE_TIMEOUT            500         // persistent connections are closed after
+                                                 // 5 sec. w/o a request (see 'TCPIdleTimeout')
+#define HTTP_CACHE_PAGE              "no-cache"  // 'Cache-Control' of pages: ask each time
+                                                 // ('If-None-Match' if there is an ETag)...
+#define HTTP_CACHE_ASSET             "max-age=86400"
+                                                 // ...and of other files: keep them a day
+
 // definitions for 'HTTPStatus'
 #define HTTP_SEND_PAGE               (0x01)      // help flag
+#define HTTP_NOT_MODIFIED            (0x02)      // response is '304 Not Modified'
+
+// HTTP methods, bits of 'THTTPRoute.Methods' (see 'HTTPMethodName')
+#define HTTP_GET                     (0x01)
+#define HTTP_HEAD                    (0x02)
+#define HTTP_POST                    (0x04)
+#define HTTP_METHODS                 3
+
+// HTTP versions (see 'HTTPVersionName')
+#define HTTP_VERSION_1_0             0
+#define HTTP_VERSION_1_1             1
+#define HTTP_VERSIONS                2
+
+// header fields the parser looks at (see 'HTTPHeaderName')
+#define HTTP_HEADER_CONNECTION       0
+#define HTTP_HEADER_ACCEPT_ENCODING  1
+#define HTTP_HEADER_IF_NONE_MATCH    2
+#define HTTP_HEADERS                 3
+
+// tokens of the 'Connection' header field (see 'HTTPConnectionToken')
+#define HTTP_CONNECTION_CLOSE        0
+#define HTTP_CONNECTION_KEEP_ALIVE   1
+#define HTTP_CONNECTION_TOKENS       2
+
+// tokens of the 'Accept-Encoding' header field (see 'HTTPEncodingToken')
+#define HTTP_ENCODING_GZIP           0
+#define HTTP_ENCODING_TOKENS         1
+
+// tokens of the 'If-None-Match' header field (see HTTPMatchValue())
+#define HTTP_ETAG_IDENTITY           0           // entity tag of the body...
+#define HTTP_ETAG_GZIP               1           // ...or of its gzip encoding
+#define HTTP_ETAG_ANY                2           // '*'
+#define HTTP_ETAG_TOKENS             3
+
+// name tables searched by HTTPMatch()
+#define HTTP_MATCH_METHOD            0
+#define HTTP_MATCH_PATH              1           // (paths of the routes)
+#define HTTP_MATCH_VERSION           2
+#define HTTP_MATCH_HEADER            3           // (case-insensitive from here on)
+#define HTTP_MATCH_CONNECTION        4           // (tokens of the header fields in the
+#define HTTP_MATCH_ENCODING          5           // order of 'HTTP_HEADER_...')
+#define HTTP_MATCH_ETAG              6           // (see HTTPMatchValue())
+#define HTTP_MATCH_QVALUE            7           // (prefixes of 'q=0.000' refuse a token)
+
+#define HTTP_NO_MATCH                (0xff)      // no name in the table, e.g. path not
+                                                 // in the route table
+
+// states of the request parser
+#define HTTP_PARSE_METHOD            0           // request line: method...
+#define HTTP_PARSE_PATH              1           // ...path...
+#define HTTP_PARSE_QUERY             2           // ...query (ignored)...
+#define HTTP_PARSE_VERSION           3           // ...and version
+#define HTTP_PARSE_LINE              4           // rest of the request line
+#define HTTP_PARSE_HEADER            5           // name of a header field, up to the
+                                                 // empty line
+#define HTTP_PARSE_VALUE             6           // value of a header field we look at...
+#define HTTP_PARSE_SKIP              7           // ...or one we ignore
+#define HTTP_PARSE_DONE              8           // request complete
+
+// definitions for 'THTTPParser.Flags'
+#define HTTP_KEEP_ALIVE              (0x01)      // connection persists after the response
+#define HTTP_SIMPLE                  (0x02)      // request w/o version and header (HTTP/0.9)
+#define HTTP_GZIP                    (0x04)      // client accepts gzip encoded bodies
+#define HTTP_IDENTITY_CACHED         (0x08)      // client has the body...
+#define HTTP_GZIP_CACHED             (0x10)      // ...or its gzip encoding already
+#define HTTP_QVALUE                  (0x20)      // parser is in the parameters of 'gzip'
+
+#define HTTP_200                     "200 OK"    // status lines
+#define HTTP_304                     "304 Not Modified"
+#define HTTP_404                     "404 Not Found"
+#define HTTP_405                     "405 Method Not Allowed"
+
+// dynamic values of the webside (see 'TWebPlaceholder')
+#define WEB_VALUE_AD7                0           // AD-converter channel 7 (P6.7)
+#define WEB_VALUE_TEMP               1           // temperature diode (channel 10)
+#define WEB_VALUES                   2           // (sampled once per response)
+#define WEB_VALUE_CRC32              2           // CRC-32 in the trailer of a gzip body
+#define WEB_MAX_VALUE_WIDTH          5           // max. chars of a value (0..65535)
+#define CRC32_POLY                   0xedb88320  // CRC-32 of gzip (bit-reflected)
+
+// channels the ADC12 samples in the background, their conversion memory
+// ADC12MEMx (see InitADC12()). the 2.5V reference draws about 0.5mA (0.8mA
+// max.) while it is on, far more than the MCU in LPM3, so it is only
+// switched on 'ADC_REF_SETTLE' before each sequence and off after it: 20%
+// of the time with these values. it needs 17ms to settle (10uF on VREF+),
+// so don't sample much faster than this without leaving it on.
+#define ADC_AD7                      0           // AD-converter channel 7 (P6.7)
+#define ADC_TEMP                     1           // temperature diode (channel 10)
+#define ADC_CHANNELS                 2
+#define ADC_SAMPLE_PERIOD            25000       // Timer_B counts (ACLK / 8 = 250 kHz) from
+                                                 // one sequence to the next (100ms)
+#define ADC_REF_SETTLE               5000        // ...of it with the reference on before
+                                                 // the sequence starts (20ms)
+
+// current readings, sent by '/values.json' (see BeginValues()): the
+// scaled values of the webside and the raw ADC12 results ('ADC_AD7'...)
+#define VALUES_FORMAT                "{\"ad7\":%u,\"temp\":%u,\"adc\":[%u,%u]}"
+#define VALUES_MAX_SIZE              48          // (incl. '\0')
+
+// sensor history, sent by '/history' (see HistoryAdd()). blocks of
+// 'HISTORY_BLOCK_SIZE' bytes, oldest first, the newest one may be shorter.
+// a block starts with the nr. of its 1st sample (16 bit, counts
+// 'HISTORY_PERIOD's) and the raw ADC12 results of it ('ADC_AD7'..., 16 bit
+// each), all little endian. each following sample is stored as the
+// differences to the one before, one code per channel:
+//   0xxxxxxx            -64...63
+//   10xxxxxx xxxxxxxx   -8192...8191 (high byte first)
+//   11111111            end of the block
+// the samples of a block are consecutive, gaps show up in the nr. of the
+// next block.
+#define HISTORY_BLOCKS               4           // nr. of blocks (power of 2)...
+#define HISTORY_BLOCK_SIZE           32          // ...and their size (RAM: 128 bytes)
+#define HISTORY_HEADER_SIZE          (2 + 2 * ADC_CHANNELS)
+#define HISTORY_PERIOD               20          // ADC sequences (100ms) per sample (2 sec.,
+                                                 // about 1.5 min. in the history)
+
+// telemetry: the samples are pushed to a collector in batches, one UDP
+// datagram each (see TelemetryAdd(), TelemetryPoll()). a datagram starts
+// with the nr. of its 1st sample (counts 'TELEMETRY_PERIOD's) and the nr.
+// of batches dropped so far (16 bit each), followed by 'TELEMETRY_BATCH'
+// samples of the raw ADC12 results ('ADC_AD7'..., 16 bit each), all
+// little endian.
+#define TELEMETRY_IP_1               192         // collector's IP address
+#define TELEMETRY_IP_2               168
+#define TELEMETRY_IP_3               1
+#define TELEMETRY_IP_4               1
+#define TELEMETRY_PORT               5150        // collector's UDP port (and ours)
+#define TELEMETRY_SOCKET             0           // UDP socket it is sent from
+#define TELEMETRY_PERIOD             10          // ADC sequences (100ms) per sample (1 sec.,
+                                                 // 0 = no telemetry)
+#define TELEMETRY_BATCH              5           // samples per datagram (RAM: 2 batches)
+#define TELEMETRY_HEADER_SIZE        4
+#define TELEMETRY_SIZE               (TELEMETRY_HEADER_SIZE + TELEMETRY_BATCH * 2 * ADC_CHANNELS)
+
+// states of the batch to be sent ('TelemetryReady')
+#define TELEMETRY_READY              1           // complete, to be sent
+#define TELEMETRY_WAIT_MAC           2           // ARP-request sent...
+#define TELEMETRY_RETRY              3           // ...send it again (next sample)
+
+// typedefs
+typedef struct                                   // request parser, one per socket
+{
+  unsigned char State;                           // see 'HTTP_PARSE_...'
+  unsigned char Pos;                             // chars of the current token or line
+  unsigned char Method;                          // 'HTTP_GET'... (0 = unknown method)
+  unsigned char Route;                           // index in 'HTTPRoutes' or 'HTTP_NO_MATCH'
+  unsigned char Header;                          // header field being parsed ('HTTP_HEADER_...')
+  unsigned char Flags;                           // 'HTTP_KEEP_ALIVE'...
+  unsigned int Candidates;                       // names still matching (see HTTPMatch())
+} THTTPParser;
+
+typedef struct                                   // placeholder in a body, listed in an
+{                                                // index like 'WebSideIndex' (webcontent.h)
+  unsigned int Ofs;                              // offset in the body
+  unsigned char Width;                           // nr. of chars replaced by the value
+  unsigned char Value;                           // 'WEB_VALUE_AD7'...
+  unsigned long CRC;                             // gzip: moves a CRC-32 behind the body,
+} TWebPlaceholder;                               // 'WEB_VALUE_CRC32': CRC-32 w/o values
+                                                 // (see GetContentCRC())
+
+typedef struct                                   // body of a resource in one encoding
+{
+  const unsigned char *Data;                     // body in flash (0 = no such encoding)...
+  unsigned int Size;                             // ...its size...
+  const TWebPlaceholder *Index;                  // ...its placeholders (0 = none)...
+  const char *ETag;                              // ...and its entity tag (quoted, 0 = none)
+} THTTPContent;
+
+typedef struct                                   // entry of the route table
+{
+  const char *Path;                              // absolute path (w/o query)
+  unsigned char Methods;                         // allowed methods ('HTTP_GET'...)
+  const char *Status;                            // status code and reason phrase
+  const char *Type;                              // 'Content-Type' of the body
+  const char *Cache;                             // 'Cache-Control' (0 = none)
+  THTTPContent Identity;                         // body...
+  THTTPContent Gzip;                             // ...and its gzip encoding (optional)
+  unsigned int (*Begin)(unsigned char Socket, const THTTPContent *Content);
+                                                 // prepares a response, returns the size
+                                                 // of the body
+  unsigned int (*Transmit)(unsigned char Socket, const THTTPContent *Content,
+    unsigned int Ofs, unsigned int Count);       // sends a part of a body, returns the
+} THTTPRoute;                                    // nr. of bytes
 
 #endif
@@ -0,0 +1,355 @@
+//------------------------------------------------------------------------------
+// Name: cs8900_host.c
+// Func: ethernet driver for the host build, replaces cs8900.c
+// Ver.: 1.1
+// Date: October 2026
+// Rem.: - same API and bus access sequences as cs8900.c, but each
+//         IOR/IOW strobe on P3/P5 goes to the CS8900A model (sim8900.c)
+//       - interrupts are only taken between two strobes, just like between
+//         two instructions on the MCU (see 'HostBusCycle')
+//       - P5DIR is switched like on the target, strobes with the wrong
+//         direction are counted as bus conflicts (see BeginRead8900())
+//------------------------------------------------------------------------------
+
+#include "sim8900.h"
+
+#include "msp430x14x.h"
+#include "cs8900.h"
+
+//------------------------------------------------------------------------------
+const unsigned int MyMAC[] =                     // "M1-M2-M3-M4-M5-M6"
+{
+  MYMAC_1 + (unsigned int)(MYMAC_2 << 8),
+  MYMAC_3 + (unsigned int)(MYMAC_4 << 8),
+  MYMAC_5 + (unsigned int)(MYMAC_6 << 8)
+};
+
+static const TInitSeq InitSeq[] =
+{
+  { PP_IA, MYMAC_1 + (MYMAC_2 << 8) },           // set our MAC as Individual Address
+  { PP_IA + 2, MYMAC_3 + (MYMAC_4 << 8) },
+  { PP_IA + 4, MYMAC_5 + (MYMAC_6 << 8) },
+  { PP_LineCTL, SERIAL_RX_ON | SERIAL_TX_ON },   // configure the Physical Interface
+  { PP_RxCTL, RX_OK_ACCEPT | RX_IA_ACCEPT | RX_BROADCAST_ACCEPT },
+  { PP_RxCFG, RX_OK_ENBL },                      // interrupt on each good frame (RxOKiE)...
+  { PP_BufCFG, RX_MISS_ENBL },                   // ...and on each missed one
+  { PP_CS8900_ISAINT, 0 },                       // use INTRQ0
+  { PP_BusCTL, ENABLE_IRQ }
+};
+
+volatile TEvents8900 Events8900;                 // pending events, see Int8900Handler()
+volatile unsigned char Sleeping8900;             // CS8900 is (maybe) in sleep mode
+
+// local function prototypes
+static void WriteIO(uint8_t Address, uint8_t Data);
+static uint8_t ReadIO(uint8_t Address);
+
+//------------------------------------------------------------------------------
+// configure the data port, issue reset and send the configuration-sequence (InitSeq[])
+//------------------------------------------------------------------------------
+void Init8900(void)
+{
+  unsigned int i;
+
+  P5DIR = 0xff;                                  // data port to output
+
+  Write8900(ADD_PORT, PP_SelfCTL);               // set register
+  Write8900(DATA_PORT, POWER_ON_RESET);          // reset the Ethernet-Controller
+
+  do
+    Write8900(ADD_PORT, PP_SelfST);              // set register
+  while (!(Read8900(DATA_PORT) & INIT_DONE));    // wait until chip-reset is done
+
+  for (i = 0; i < sizeof InitSeq / sizeof (TInitSeq); i++) // configure the CS8900
+  {
+    Write8900(ADD_PORT, InitSeq[i].Addr);
+    Write8900(DATA_PORT, InitSeq[i].Data);
+  }
+
+  Events8900.RxEvent = 0;
+  Sleeping8900 = 0;
+  P2SEL &= ~INTRQ;                               // INTRQ is an input,
+  P2DIR &= ~INTRQ;
+  P2IES &= ~INTRQ;                               // int. on its rising edge
+  P2IFG &= ~INTRQ;
+  Enable8900Int();
+}
+//------------------------------------------------------------------------------
+// writes a word in little-endian byte order to
+// a specified port-address
+//------------------------------------------------------------------------------
+void Write8900(unsigned char Address, unsigned int Data)
+{
+  unsigned char Direction = P5DIR;               // (maybe inside a read window)
+
+  P5DIR = 0xff;
+  WriteIO(Address, Data);
+  WriteIO(Address + 1, Data >> 8);
+  P5DIR = Direction;
+}
+//------------------------------------------------------------------------------
+// writes a word in little-endian byte order to TX_FRAME_PORT
+//------------------------------------------------------------------------------
+void WriteFrame8900(unsigned int Data)
+{
+  unsigned char Direction = P5DIR;
+
+  P5DIR = 0xff;
+  WriteIO(TX_FRAME_PORT, Data);
+  WriteIO(TX_FRAME_PORT + 1, Data >> 8);
+  P5DIR = Direction;
+}
+//------------------------------------------------------------------------------
+// copies bytes from MCU-memory to frame port
+// NOTES:     * MCU-memory may start at any address, like on the target
+//------------------------------------------------------------------------------
+void CopyToFrame8900(const void *Source, unsigned int Size)
+{
+  const unsigned char *pSource = Source;
+  unsigned char Direction = P5DIR;
+
+  P5DIR = 0xff;
+
+  while (Size > 1)
+  {
+    WriteIO(TX_FRAME_PORT, *pSource++);
+    WriteIO(TX_FRAME_PORT + 1, *pSource++);
+    Size -= 2;
+  }
+
+  if (Size)                                      // if odd num. of bytes...
+    WriteIO(TX_FRAME_PORT, *pSource);
+
+  P5DIR = Direction;
+}
+//------------------------------------------------------------------------------
+// reads a word in little-endian byte order from
+// a specified port-address
+//------------------------------------------------------------------------------
+unsigned int Read8900(unsigned char Address)
+{
+  unsigned char Direction = P5DIR;
+  unsigned int ReturnValue;
+
+  P5DIR = 0x00;
+  ReturnValue = ReadIO(Address);
+  ReturnValue |= ReadIO(Address + 1) << 8;
+  P5DIR = Direction;
+
+  return ReturnValue;
+}
+//------------------------------------------------------------------------------
+// reads a word in little-endian byte order from RX_FRAME_PORT
+// (inside a read window)
+//------------------------------------------------------------------------------
+unsigned int ReadFrame8900(void)
+{
+  unsigned int ReturnValue;
+
+  ReturnValue = ReadIO(RX_FRAME_PORT);
+  ReturnValue |= ReadIO(RX_FRAME_PORT + 1) << 8;
+
+  return ReturnValue;
+}
+//------------------------------------------------------------------------------
+// reads a word in big-endian byte order from RX_FRAME_PORT
+// (inside a read window)
+//------------------------------------------------------------------------------
+unsigned int ReadFrameBE8900(void)
+{
+  unsigned int ReturnValue;
+
+  ReturnValue = ReadIO(RX_FRAME_PORT) << 8;
+  ReturnValue |= ReadIO(RX_FRAME_PORT + 1);
+
+  return ReturnValue;
+}
+//------------------------------------------------------------------------------
+// reads a word in little-endian byte order from
+// a specified port-address, high-byte 1st (e.g. RxStatus),
+// inside a read window
+//------------------------------------------------------------------------------
+unsigned int ReadHB1ST8900(unsigned char Address)
+{
+  unsigned int ReturnValue;
+
+  ReturnValue = ReadIO(Address + 1) << 8;
+  ReturnValue |= ReadIO(Address);
+
+  return ReturnValue;
+}
+//------------------------------------------------------------------------------
+// copies bytes from frame port to MCU-memory (inside a read window)
+// NOTES:     * MCU-memory may start at any address, like on the target
+//------------------------------------------------------------------------------
+void CopyFromFrame8900(void *Dest, unsigned int Size)
+{
+  unsigned char *pDest = Dest;
+
+  while (Size > 1)
+  {
+    *pDest++ = ReadIO(RX_FRAME_PORT);
+    *pDest++ = ReadIO(RX_FRAME_PORT + 1);
+    Size -= 2;
+  }
+
+  if (Size)                                      // check for leftover byte...
+    *pDest = ReadIO(RX_FRAME_PORT);
+}
+//------------------------------------------------------------------------------
+// does a dummy read on the CS8900A frame-I/O-port (inside a read window)
+//------------------------------------------------------------------------------
+void DummyReadFrame8900(unsigned int Size)
+{
+  while (Size--)
+    ReadIO(RX_FRAME_PORT);
+}
+//------------------------------------------------------------------------------
+// copies bytes from frame port to MCU-memory (inside a read window) and
+// adds them to the one's complement sum 'Sum', returns the new sum
+// NOTES:     * MCU-memory MUST start at word-boundary
+//------------------------------------------------------------------------------
+unsigned int CopyFromFrameSum8900(void *Dest, unsigned int Size, unsigned int Sum)
+{
+  unsigned int *pDest = Dest;
+  unsigned long NewSum = Sum;
+
+  while (Size > 1)
+  {
+    *pDest = ReadIO(RX_FRAME_PORT);
+    *pDest |= ReadIO(RX_FRAME_PORT + 1) << 8;
+    NewSum += *pDest++;
+    Size -= 2;
+  }
+
+  if (Size)                                      // check for leftover byte...
+  {
+    *(unsigned char *)pDest = ReadIO(RX_FRAME_PORT);
+    NewSum += *(unsigned char *)pDest;
+  }
+
+  while (NewSum >> 16)                           // end-around carry
+    NewSum = (NewSum & 0xffff) + (NewSum >> 16);
+
+  return NewSum;
+}
+//------------------------------------------------------------------------------
+// does a dummy read on the CS8900A frame-I/O-port (inside a read window)
+// and adds the bytes to the one's complement sum 'Sum', returns the new sum
+//------------------------------------------------------------------------------
+unsigned int DummyReadFrameSum8900(unsigned int Size, unsigned int Sum)
+{
+  unsigned long NewSum = Sum;
+
+  while (Size > 1)
+  {
+    NewSum += ReadFrame8900();
+    Size -= 2;
+  }
+
+  if (Size)                                      // check for leftover byte...
+    NewSum += ReadIO(RX_FRAME_PORT);
+
+  while (NewSum >> 16)                           // end-around carry
+    NewSum = (NewSum & 0xffff) + (NewSum >> 16);
+
+  return NewSum;
+}
+//------------------------------------------------------------------------------
+// discards the rest of the received frame. the CS8900 then reports the
+// next one (if any) via the ISQ.
+//------------------------------------------------------------------------------
+void Skip8900(void)
+{
+  Write8900(ADD_PORT, PP_RxCFG);
+  Write8900(DATA_PORT, RX_OK_ENBL | SKIP_1);     // (keep RxOKiE set)
+}
+//------------------------------------------------------------------------------
+// puts the CS8900 into sleep mode. it wakes up by itself on receive
+// activity (the frame that wakes it up is lost) or when the next frame
+// is sent (RequestSend())
+//------------------------------------------------------------------------------
+void Sleep8900(void)
+{
+  Write8900(ADD_PORT, PP_SelfCTL);
+  Write8900(DATA_PORT, SLEEP_ON | AUTO_WAKEUP);
+  Sleeping8900 = 1;
+}
+//------------------------------------------------------------------------------
+// requests space in CS8900 on-chip memory for
+// storing an outgoing frame
+//------------------------------------------------------------------------------
+void RequestSend(unsigned int FrameSize)
+{
+  if (Sleeping8900)                              // wake it up first
+  {
+    Write8900(ADD_PORT, PP_SelfCTL);
+    Write8900(DATA_PORT, 0);
+    Sleeping8900 = 0;
+  }
+
+  Write8900(TX_CMD_PORT, TX_START_ALL_BYTES);
+  Write8900(TX_LEN_PORT, FrameSize);
+}
+//------------------------------------------------------------------------------
+// check if CS8900 is ready to accept the
+// frame we want to send
+//------------------------------------------------------------------------------
+unsigned int Rdy4Tx(void)
+{
+  Write8900(ADD_PORT, PP_BusST);
+  return Read8900(DATA_PORT) & READY_FOR_TX_NOW;
+}
+//------------------------------------------------------------------------------
+// one IOW strobe
+//------------------------------------------------------------------------------
+static void WriteIO(uint8_t Address, uint8_t Data)
+{
+  if (P5DIR != 0xff) Sim8900Stats.BusConflicts++;  // CS8900 would latch a floating bus
+
+  HostBusCycle = 1;
+  Sim8900WriteIO(Address, Data);
+  HostBusCycleEnd();
+}
+//------------------------------------------------------------------------------
+// one IOR strobe
+//------------------------------------------------------------------------------
+static uint8_t ReadIO(uint8_t Address)
+{
+  uint8_t Value;
+
+  if (P5DIR != 0x00) Sim8900Stats.BusConflicts++;  // both sides drive the bus
+
+  HostBusCycle = 1;
+  Value = Sim8900ReadIO(Address);
+  HostBusCycleEnd();
+
+  return Value;
+}
+//------------------------------------------------------------------------------
+// INTRQ interrupt: drains the ISQ into 'Events8900'. a received frame is
+// reported once, the next one only after it has been skipped (Skip8900()).
+// must not interrupt other bus accesses (see Disable8900Int()).
+//------------------------------------------------------------------------------
+#pragma vector = PORT2_VECTOR
+__interrupt void Int8900Handler(void)
+{
+  unsigned int Event;
+
+  P2IFG &= ~INTRQ;                               // reset int.-flag, INTRQ drops when
+                                                 // the ISQ is empty
+  while ((Event = Read8900(ISQ_PORT)))
+    switch (Event & ISQ_EVENT_MASK)
+    {
+      case ISQ_RX_EVENT :                        // frame ready at RX_FRAME_PORT
+        Events8900.RxEvent = Event;
+        Sleeping8900 = 0;                        // (woke up by itself)
+        break;
+      case ISQ_BUFFER_EVENT :
+        if (Event & RX_MISS) Events8900.RxMissed++;
+        break;
+    }
+
+  if (Events8900.RxEvent)
+    __bic_SR_register_on_exit(LPM3_bits);        // wake up the main program
+}
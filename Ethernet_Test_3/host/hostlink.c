@@ -0,0 +1,217 @@
+//------------------------------------------------------------------------------
+// Name: hostlink.c
+// Func: connects the CS8900A model to a Linux TAP interface (host build)
+// Ver.: 1.1
+// Date: October 2026
+// Rem.: - environment variables:
+//         EASYWEB_TAP   name of the TAP interface (default "tap0")
+//         EASYWEB_PCAP  if set, all frames are logged to this pcap file
+//         EASYWEB_DELAY if set, frames from the network are delayed by
+//                       this nr. of microseconds (simulated round trip)
+//         EASYWEB_LOSS  if set, this percentage of frames is dropped in
+//                       each direction (simulated packet loss)
+//       - bus and frame counters are printed on exit (Ctrl-C)
+//       - frames from the network raise SIGIO, which runs the MCU's
+//         interrupt logic (msp430_host.c) and with it Service()
+//------------------------------------------------------------------------------
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#include "sim8900.h"
+
+#define DELAY_QUEUE_SIZE     64                  // frames on the way to the CS8900A
+
+// typedefs
+typedef struct
+{
+  uint64_t Due;                                  // time to pass it to the model (us)
+  unsigned Size;
+  uint8_t Data[SIM_MAX_FRAME_SIZE];
+} TDelayedFrame;
+
+static int TapFd = -1;
+static FILE *PcapFile;
+static unsigned Delay;                           // simulated latency (us)
+static unsigned Loss;                            // simulated loss (%)
+static unsigned Lost;                            // frames dropped so far
+static TDelayedFrame DelayQueue[DELAY_QUEUE_SIZE];
+static unsigned DelayHead;
+static unsigned DelayCount;
+
+// local function prototypes
+static uint64_t Now(void);
+static int IsLost(void);
+static void WritePcap(const uint8_t *Frame, unsigned Size);
+static void Service(void);
+static void PrintStats(void);
+static void OnSignal(int Signal);
+//------------------------------------------------------------------------------
+// returns the host time in microseconds
+//------------------------------------------------------------------------------
+static uint64_t Now(void)
+{
+  struct timeval Time;
+
+  gettimeofday(&Time, NULL);
+  return (uint64_t)Time.tv_sec * 1000000 + Time.tv_usec;
+}
+//------------------------------------------------------------------------------
+// decides if the next frame gets lost on the wire
+//------------------------------------------------------------------------------
+static int IsLost(void)
+{
+  if (!Loss || (unsigned)(rand() % 100) >= Loss) return 0;
+
+  Lost++;
+  return 1;
+}
+//------------------------------------------------------------------------------
+// appends a frame to the pcap log
+//------------------------------------------------------------------------------
+static void WritePcap(const uint8_t *Frame, unsigned Size)
+{
+  struct timeval Time;
+  uint32_t Record[4];
+
+  if (!PcapFile) return;
+
+  gettimeofday(&Time, NULL);
+  Record[0] = Time.tv_sec;                       // timestamp
+  Record[1] = Time.tv_usec;
+  Record[2] = Size;                              // captured / original length
+  Record[3] = Size;
+  fwrite(Record, sizeof Record, 1, PcapFile);
+  fwrite(Frame, Size, 1, PcapFile);
+}
+//------------------------------------------------------------------------------
+// called by the model when the MCU has sent a frame or polls for a new
+// one, and by the interrupt logic: sends what the MCU has transmitted and
+// queues what the network has sent
+//------------------------------------------------------------------------------
+static void Service(void)
+{
+  uint8_t Frame[SIM_MAX_FRAME_SIZE];
+  TDelayedFrame *pDelayed;
+  unsigned TxSize;
+  ssize_t RxSize;
+
+  while ((TxSize = Sim8900GetTxFrame(Frame)))
+  {
+    if (IsLost()) continue;
+    WritePcap(Frame, TxSize);
+    if (write(TapFd, Frame, TxSize) < 0)
+      perror("easyWEB host: TAP write");
+  }
+
+  if (!Delay)
+  {
+    while ((RxSize = read(TapFd, Frame, sizeof Frame)) > 0)
+      if (!IsLost() && Sim8900PutRxFrame(Frame, RxSize))
+        WritePcap(Frame, RxSize);
+    return;
+  }
+
+  while (DelayCount < DELAY_QUEUE_SIZE)          // put new frames on the wire...
+  {
+    pDelayed = &DelayQueue[(DelayHead + DelayCount) % DELAY_QUEUE_SIZE];
+    RxSize = read(TapFd, pDelayed->Data, sizeof pDelayed->Data);
+    if (RxSize <= 0) break;
+    if (IsLost()) continue;
+    pDelayed->Size = RxSize;
+    pDelayed->Due = Now() + Delay;
+    DelayCount++;
+  }
+
+  while (DelayCount)                             // ...and pass them on when they arrive
+  {
+    pDelayed = &DelayQueue[DelayHead];
+    if (pDelayed->Due > Now()) break;
+    if (Sim8900PutRxFrame(pDelayed->Data, pDelayed->Size))
+      WritePcap(pDelayed->Data, pDelayed->Size);
+    DelayHead = (DelayHead + 1) % DELAY_QUEUE_SIZE;
+    DelayCount--;
+  }
+}
+//------------------------------------------------------------------------------
+static void PrintStats(void)
+{
+  fprintf(stderr,
+    "\neasyWEB host: CS8900A statistics\n"
+    "  bus reads     %10u\n"
+    "  bus writes    %10u\n"
+    "  rx frames     %10u (%u bytes, %u dropped)\n"
+    "  tx frames     %10u (%u bytes, %u bid errors)\n"
+    "  auto wakeups  %10u\n"
+    "  bus conflicts %10u\n"
+    "  lost on wire  %10u\n",
+    Sim8900Stats.IOReads, Sim8900Stats.IOWrites,
+    Sim8900Stats.RxFrames, Sim8900Stats.RxBytes, Sim8900Stats.RxDropped,
+    Sim8900Stats.TxFrames, Sim8900Stats.TxBytes, Sim8900Stats.TxBidErrors,
+    Sim8900Stats.AutoWakeups, Sim8900Stats.BusConflicts, Lost);
+
+  if (PcapFile) fclose(PcapFile);
+}
+//------------------------------------------------------------------------------
+static void OnSignal(int Signal)
+{
+  (void)Signal;
+  exit(0);                                       // runs PrintStats()
+}
+//------------------------------------------------------------------------------
+// opens the TAP interface before easyWEB's main() is entered
+//------------------------------------------------------------------------------
+__attribute__((constructor))
+static void HostLinkInit(void)
+{
+  static const uint32_t PcapHeader[6] =
+  {
+    0xa1b2c3d4, 0x00040002, 0, 0, 65535, 1       // v2.4, LINKTYPE_ETHERNET
+  };
+  const char *Name;
+  struct ifreq Request;
+
+  Name = getenv("EASYWEB_TAP");
+  if (!Name) Name = "tap0";
+
+  TapFd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+  memset(&Request, 0, sizeof Request);
+  Request.ifr_flags = IFF_TAP | IFF_NO_PI;
+  strncpy(Request.ifr_name, Name, IFNAMSIZ - 1);
+
+  if (TapFd < 0 || ioctl(TapFd, TUNSETIFF, &Request) < 0)
+  {
+    perror("easyWEB host: cannot attach to TAP interface");
+    exit(1);
+  }
+
+  fcntl(TapFd, F_SETOWN, getpid());              // SIGIO for each frame
+  fcntl(TapFd, F_SETFL, O_RDWR | O_NONBLOCK | O_ASYNC);
+
+  if (getenv("EASYWEB_DELAY"))
+    Delay = strtoul(getenv("EASYWEB_DELAY"), NULL, 0);
+
+  if (getenv("EASYWEB_LOSS"))
+    Loss = strtoul(getenv("EASYWEB_LOSS"), NULL, 0);
+
+  if (getenv("EASYWEB_PCAP"))
+  {
+    PcapFile = fopen(getenv("EASYWEB_PCAP"), "wb");
+    if (PcapFile) fwrite(PcapHeader, sizeof PcapHeader, 1, PcapFile);
+  }
+
+  Sim8900SetServiceHook(Service);
+  atexit(PrintStats);
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+
+  fprintf(stderr, "easyWEB host: attached to %s\n", Request.ifr_name);
+}
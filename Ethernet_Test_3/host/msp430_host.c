@@ -0,0 +1,590 @@
+//------------------------------------------------------------------------------
+// Name: msp430_host.c
+// Func: MSP430 peripheral stand-ins for the Linux host build
+// Ver.: 1.1
+// Date: October 2026
+// Rem.: - plain registers are just memory, Timer_A, Timer_B (as the trigger
+//         of the ADC12), ADC12 and the interrupt logic are emulated as far
+//         as easyWEB relies on them
+//       - the interrupt logic runs from SIGALRM (every 'HOST_TICK' us) and
+//         SIGIO (frame from the network): it lets the CS8900A model talk to
+//         the network, wires its INTRQ0 to P2.0 and calls the ISRs
+//       - a low-power mode (CPUOFF) suspends the process until an ISR ends
+//         it, the time spent in it is printed on exit
+//------------------------------------------------------------------------------
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "sim8900.h"
+
+#include "msp430x14x.h"
+#include "cs8900.h"
+
+#define HOST_TICK            100                 // interrupt logic runs at least every 0.1ms
+#define HOST_BENCHMARK_RUNS  100000              // sums per size (see HostBenchmark())
+
+// easyWEB's interrupt service routines (the vector table)
+extern void TCPClockHandler(void);               // TIMERA1_VECTOR
+extern void Int8900Handler(void);                // PORT2_VECTOR
+extern void ADC12Handler(void);                  // ADC12_VECTOR
+extern void ADCRefHandler(void);                 // TIMERB1_VECTOR
+
+// interrupt logic
+volatile unsigned int HostSR;
+volatile unsigned int HostSavedSR;
+volatile unsigned char HostBusCycle;
+static volatile unsigned char InInterruptLogic;
+static volatile unsigned char Deferred;          // signal came during a bus cycle
+static uint64_t StartTime;                       // host time at start-up (us)
+static uint64_t LPMTime;                         // time spent in a low-power mode (us)
+static unsigned LPMEntries;
+
+// special function registers
+volatile unsigned char IE1;
+volatile unsigned char IFG1;
+
+// watchdog timer, basic clock system
+volatile unsigned int WDTCTL;
+volatile unsigned char DCOCTL;
+volatile unsigned char BCSCTL1;
+volatile unsigned char BCSCTL2;
+
+// digital I/O
+volatile unsigned char P1IN, P1OUT, P1DIR, P1SEL, P1IFG, P1IES, P1IE;
+volatile unsigned char P2IN, P2OUT, P2DIR, P2SEL, P2IFG, P2IES, P2IE;
+volatile unsigned char P3IN, P3OUT, P3DIR, P3SEL;
+volatile unsigned char P4IN, P4OUT, P4DIR, P4SEL;
+volatile unsigned char P5IN, P5OUT, P5DIR, P5SEL;
+volatile unsigned char P6IN, P6OUT, P6DIR, P6SEL;
+
+// Timer_A
+volatile unsigned int TACTL;
+volatile unsigned int CCTL1;
+volatile unsigned int CCR1;
+static volatile unsigned int TARValue;
+static volatile unsigned int TAIVValue;
+static unsigned int TimerALast;                  // count up to which flags were set
+
+// Timer_B
+volatile unsigned int TBCTL;
+volatile unsigned int TBCCTL1;
+volatile unsigned int TBCCR0;
+volatile unsigned int TBCCR1;
+static unsigned int TimerBStart;                 // count at which TBR was 0 last time
+static unsigned char TimerBAtCCR1;               // TBR has reached TBCCR1 in this period
+
+// ADC12
+static volatile unsigned int ADC12CTL0Value;
+volatile unsigned int ADC12CTL1;
+volatile unsigned char ADC12MCTL[16];
+static volatile unsigned int ADC12MEMValue[16];
+volatile unsigned int ADC12IFG;
+volatile unsigned int ADC12IE;
+static unsigned char ADC12Idle;                  // ENC was reset since the last sequence
+
+#define HOST_AD7_VALUE       (0x0800)            // simulated P6.7 input (mid-scale)
+#define HOST_TEMP_VALUE      (0x06E0)            // simulated temp. diode (25C)
+
+static unsigned int AD7Input = HOST_AD7_VALUE;
+static unsigned int AD7Step;                     // added after each conversion
+                                                 // (EASYWEB_AD7_STEP)
+
+// local function prototypes
+static uint64_t Now(void);
+static unsigned int HostClock(void);
+static unsigned char TimerAAdvance(unsigned int Count);
+static unsigned char TimerBAdvance(unsigned int Count);
+static void ADC12Trigger(void);
+static unsigned int ADC12Convert(unsigned char Control);
+static void WireINTRQ(void);
+static void CallISR(void (*Handler)(void));
+static void InterruptLogic(void);
+static void OnSignal(signed Signal);
+static void PrintStats(void);
+static void HostBenchmark(void);
+static unsigned int ChecksumAddC(const void *Start, unsigned int Count, unsigned int Sum);
+
+//------------------------------------------------------------------------------
+// returns the host's monotonic clock in microseconds
+//------------------------------------------------------------------------------
+static uint64_t Now(void)
+{
+  struct timespec Time;
+
+  clock_gettime(CLOCK_MONOTONIC, &Time);
+  return (uint64_t)Time.tv_sec * 1000000 + Time.tv_nsec / 1000;
+}
+//------------------------------------------------------------------------------
+// returns the count Timer_A should have reached by now
+// (ACLK / 8 = 250 kHz as configured by TCPLowLevelInit())
+//------------------------------------------------------------------------------
+static unsigned int HostClock(void)
+{
+  return Now() / 4;
+}
+//------------------------------------------------------------------------------
+// returns Timer_A's counter. it is brought up to date first (the flags of
+// the events on the way are set), so that TAR and TAIFG agree.
+//------------------------------------------------------------------------------
+volatile unsigned int *HostTAR(void)
+{
+  HostBusCycle = 1;                              // keep the interrupt logic out
+  while (TimerAAdvance(HostClock()));
+  TARValue = TimerALast;
+  HostBusCycleEnd();
+
+  return &TARValue;
+}
+//------------------------------------------------------------------------------
+// returns Timer_A's interrupt vector register and resets the flag of the
+// interrupt it reports (highest priority first)
+//------------------------------------------------------------------------------
+volatile unsigned int *HostTAIV(void)
+{
+  TAIVValue = 0;
+
+  if ((CCTL1 & (CCIE | CCIFG)) == (CCIE | CCIFG))
+  {
+    CCTL1 &= ~CCIFG;
+    TAIVValue = 2;
+  }
+  else if ((TACTL & (TAIE | TAIFG)) == (TAIE | TAIFG))
+  {
+    TACTL &= ~TAIFG;
+    TAIVValue = 10;
+  }
+
+  return &TAIVValue;
+}
+//------------------------------------------------------------------------------
+// lets Timer_A count up to 'Count', but stops at the next event (CCR1
+// reached, overflow) to set its flag. returns 0 when 'Count' was reached.
+//------------------------------------------------------------------------------
+static unsigned char TimerAAdvance(unsigned int Count)
+{
+  uint32_t ToCount = (unsigned int)(Count - TimerALast);
+  uint32_t ToCCR1 = (unsigned int)(CCR1 - TimerALast);
+  uint32_t ToOverflow = (unsigned int)(0 - TimerALast);
+
+  if (!ToCCR1) ToCCR1 = 0x10000;                 // just passed, next time in a period
+  if (!ToOverflow) ToOverflow = 0x10000;
+  if (ToOverflow < ToCCR1) ToCCR1 = ToOverflow;  // distance to the next event
+
+  if (ToCCR1 > ToCount)
+  {
+    TimerALast = Count;
+    return 0;
+  }
+
+  TimerALast += ToCCR1;
+  if (TimerALast == CCR1) CCTL1 |= CCIFG;
+  if (!TimerALast) TACTL |= TAIFG;
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+// the board: INTRQ0 of the CS8900A drives P2.0, P2IFG is set on the edge
+// selected by P2IES
+//------------------------------------------------------------------------------
+static void WireINTRQ(void)
+{
+  unsigned char Level = Sim8900IRQ() ? INTRQ : 0;
+
+  if ((P2IN & INTRQ) != Level && !(P2DIR & INTRQ))
+    if ((P2IES & INTRQ) ? !Level : Level)
+      P2IFG |= INTRQ;
+
+  P2IN = (P2IN & ~INTRQ) | Level;
+}
+//------------------------------------------------------------------------------
+// enters an ISR like the MCU does: SR is saved and cleared (GIE and the
+// low-power bits), 'reti' restores it. the ISR may change the saved SR
+// (__bic_SR_register_on_exit()).
+//------------------------------------------------------------------------------
+static void CallISR(void (*Handler)(void))
+{
+  HostSavedSR = HostSR;
+  HostSR &= SCG0;
+  Handler();
+  HostSR = HostSavedSR;
+}
+//------------------------------------------------------------------------------
+// sets bits in the SR. with CPUOFF the main program stops until an ISR
+// clears it on exit, the process waits for the next signal meanwhile.
+//------------------------------------------------------------------------------
+void HostBisSR(unsigned int Bits)
+{
+  sigset_t Signals, Unblocked;
+  uint64_t Start;
+
+  HostSR |= Bits;
+  if (!(HostSR & CPUOFF)) return;
+
+  sigemptyset(&Signals);
+  sigaddset(&Signals, SIGALRM);
+  sigaddset(&Signals, SIGIO);
+  sigprocmask(SIG_BLOCK, &Signals, &Unblocked);
+
+  Start = Now();
+  LPMEntries++;
+  InterruptLogic();                              // maybe an interrupt is pending already
+
+  while (HostSR & CPUOFF)
+    sigsuspend(&Unblocked);
+
+  LPMTime += Now() - Start;
+  sigprocmask(SIG_SETMASK, &Unblocked, NULL);
+}
+//------------------------------------------------------------------------------
+// runs the network side of the CS8900A, advances Timer_A and calls the ISRs
+// of all pending interrupts. if the MCU is just accessing the CS8900A, it
+// all happens at the end of that bus cycle.
+//------------------------------------------------------------------------------
+static void InterruptLogic(void)
+{
+  unsigned int Count;
+  unsigned char TimerEvent;
+
+  if (HostBusCycle || InInterruptLogic)
+  {
+    Deferred = 1;
+    return;
+  }
+
+  InInterruptLogic = 1;
+
+  do
+  {
+    Deferred = 0;
+    Sim8900Service();                            // exchange frames with the network
+
+    do
+    {
+      Count = HostClock();
+      TimerEvent = TimerAAdvance(Count);
+      TimerEvent |= TimerBAdvance(Count);
+      WireINTRQ();
+
+      while (HostSR & GIE)                       // (highest priority first)
+      {
+        if ((TBCCTL1 & (CCIE | CCIFG)) == (CCIE | CCIFG))
+          CallISR(ADCRefHandler);
+        else if (ADC12IFG & ADC12IE)
+          CallISR(ADC12Handler);
+        else if ((CCTL1 & (CCIE | CCIFG)) == (CCIE | CCIFG) ||
+            (TACTL & (TAIE | TAIFG)) == (TAIE | TAIFG))
+          CallISR(TCPClockHandler);
+        else if (P2IFG & P2IE)
+          CallISR(Int8900Handler);
+        else
+          break;
+
+        WireINTRQ();
+      }
+    }
+    while (TimerEvent);
+  }
+  while (Deferred);
+
+  InInterruptLogic = 0;
+}
+//------------------------------------------------------------------------------
+// called by the host driver after each bus cycle
+//------------------------------------------------------------------------------
+void HostBusCycleEnd(void)
+{
+  HostBusCycle = 0;
+
+  if (Deferred) InterruptLogic();
+}
+//------------------------------------------------------------------------------
+static void OnSignal(signed Signal)
+{
+  (void)Signal;
+  InterruptLogic();
+}
+//------------------------------------------------------------------------------
+static void PrintStats(void)
+{
+  uint64_t Total = Now() - StartTime;
+
+  fprintf(stderr,
+    "\neasyWEB host: MCU statistics\n"
+    "  active        %10.3f s\n"
+    "  low-power     %10.3f s (%u times)\n",
+    (Total - LPMTime) / 1e6, LPMTime / 1e6, LPMEntries);
+}
+//------------------------------------------------------------------------------
+// starts the interrupt logic before any other part of the host build
+// (the host link enables SIGIO)
+//------------------------------------------------------------------------------
+__attribute__((constructor(101)))
+static void HostInit(void)
+{
+  struct sigaction Action;
+  struct itimerval Tick;
+
+  StartTime = Now();
+  TimerALast = HostClock();
+
+  memset(&Action, 0, sizeof Action);
+  Action.sa_handler = OnSignal;
+  Action.sa_flags = SA_RESTART;
+  sigemptyset(&Action.sa_mask);
+  sigaddset(&Action.sa_mask, SIGALRM);           // never nested
+  sigaddset(&Action.sa_mask, SIGIO);
+  sigaction(SIGALRM, &Action, NULL);
+  sigaction(SIGIO, &Action, NULL);
+
+  Tick.it_interval.tv_sec = 0;
+  Tick.it_interval.tv_usec = HOST_TICK;
+  Tick.it_value = Tick.it_interval;
+  setitimer(ITIMER_REAL, &Tick, NULL);
+
+  atexit(PrintStats);
+
+  if (getenv("EASYWEB_AD7_STEP")) AD7Step = atoi(getenv("EASYWEB_AD7_STEP"));
+  if (getenv("EASYWEB_BENCHMARK")) HostBenchmark();
+}
+//------------------------------------------------------------------------------
+// returns ADC12CTL0. a conversion started by ADC12SC is completed
+// the next time the register is accessed.
+//------------------------------------------------------------------------------
+volatile unsigned int *HostADC12CTL0(void)
+{
+  if ((ADC12CTL0Value & (ENC | ADC12SC)) == (ENC | ADC12SC))
+  {
+    ADC12MEMValue[0] = ADC12Convert(ADC12MCTL0);
+    ADC12CTL0Value &= ~ADC12SC;                  // conversion complete
+  }
+
+  return &ADC12CTL0Value;
+}
+//------------------------------------------------------------------------------
+// returns ADC12MEMx ('Index') and resets its flag in ADC12IFG
+//------------------------------------------------------------------------------
+volatile unsigned int *HostADC12MEM(unsigned char Index)
+{
+  ADC12IFG &= ~(1u << Index);
+  return &ADC12MEMValue[Index];
+}
+//------------------------------------------------------------------------------
+// lets Timer_B count up to 'Count' in up mode (from ACLK / 8, like Timer_A),
+// but stops at the next event: TBR reaching TBCCR1 sets its flag, reaching
+// TBCCR0 gives the rising edge of OUT1 (OUTMOD_7) that triggers the ADC12.
+// returns 0 when 'Count' was reached.
+//------------------------------------------------------------------------------
+static unsigned char TimerBAdvance(unsigned int Count)
+{
+  unsigned int Elapsed = Count - TimerBStart;
+
+  if (!(ADC12CTL0Value & ENC))                   // (polled, the MCU would see any
+    ADC12Idle = 1;                               // toggle of ENC)
+
+  if ((TBCTL & (MC_1 | MC_2)) != MC_1)
+  {
+    TimerBStart = Count;                         // not running, no events
+    TimerBAtCCR1 = 0;
+    return 0;
+  }
+
+  if (!TimerBAtCCR1 && (TBCCR1 <= TBCCR0))
+  {
+    if (Elapsed < TBCCR1) return 0;
+
+    TimerBAtCCR1 = 1;
+    TBCCTL1 |= CCIFG;
+    return 1;
+  }
+
+  if (Elapsed < TBCCR0) return 0;
+
+  TimerBStart += TBCCR0 + 1;                     // TBR starts again from 0
+  TimerBAtCCR1 = 0;
+  if ((TBCCTL1 & OUTMOD_7) == OUTMOD_7) ADC12Trigger();
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+// rising edge of Timer_B.OUT1 (SHS_3): in sequence-of-channels mode (CONSEQ_1)
+// with MSC the whole sequence is converted at once, from ADC12MEM0 up to the
+// one with the EOS bit, and their flags are set in ADC12IFG. like on the MCU
+// ENC has to be toggled before the next sequence starts.
+//------------------------------------------------------------------------------
+static void ADC12Trigger(void)
+{
+  unsigned char i = 0;
+
+  if (((ADC12CTL1 & (SHS_3 | CONSEQ_3)) != (SHS_3 | CONSEQ_1)) ||
+      ((ADC12CTL0Value & (ENC | MSC)) != (ENC | MSC)) || !ADC12Idle)
+    return;
+
+  ADC12Idle = 0;
+
+  do
+  {
+    ADC12MEMValue[i] = ADC12Convert(ADC12MCTL[i]);
+    ADC12IFG |= 1u << i;
+  }
+  while (!(ADC12MCTL[i] & EOS) && (++i < 16));
+}
+//------------------------------------------------------------------------------
+// returns the simulated result of a conversion with the settings 'Control'
+// (ADC12MCTLx). w/o the reference switched on (REFON) the input is above
+// VREF+ and the result is full scale.
+//------------------------------------------------------------------------------
+static unsigned int ADC12Convert(unsigned char Control)
+{
+  unsigned int Value = AD7Input;
+
+  if (((Control & SREF_7) == SREF_1) && !(ADC12CTL0Value & REFON))
+    return 0x0fff;
+
+  if ((Control & 0x0f) == INCH_10)               // temperature diode
+    return HOST_TEMP_VALUE;
+
+  AD7Input = (AD7Input + AD7Step) & 0x0fff;      // (a sawtooth)
+  return Value;
+}
+//------------------------------------------------------------------------------
+// C version of the MSP430 assembly routine in tcpip.c
+// writes a dword in big-endian byte order to memory
+//------------------------------------------------------------------------------
+void WriteDWBE(unsigned char *Add, unsigned long Data)
+{
+  Add[0] = Data >> 24;
+  Add[1] = Data >> 16;
+  Add[2] = Data >> 8;
+  Add[3] = Data;
+}
+//------------------------------------------------------------------------------
+// C version of the MSP430 assembly routine in tcpip.c
+// adds 'Count' bytes at 'Start' to the one's complement sum 'Sum'. the host
+// is little-endian like the MSP430, so the words are summed in the 32 bit
+// lanes of a vector register (16 words per pass with AVX2, 8 with SSE2),
+// which are added up and folded once at the end.
+//------------------------------------------------------------------------------
+unsigned int ChecksumAdd(const void *Start, unsigned int Count, unsigned int Sum)
+{
+  const uint8_t *pStart = Start;
+  uint64_t NewSum = Sum;
+  uint32_t Lanes[8];
+  unsigned i;
+
+#if defined(__AVX2__)
+  __m256i Acc = _mm256_setzero_si256();
+
+  for (; Count >= 32; Count -= 32, pStart += 32)
+  {
+    __m256i Words = _mm256_loadu_si256((const __m256i *)pStart);
+
+    Acc = _mm256_add_epi32(Acc, _mm256_unpacklo_epi16(Words, _mm256_setzero_si256()));
+    Acc = _mm256_add_epi32(Acc, _mm256_unpackhi_epi16(Words, _mm256_setzero_si256()));
+  }
+  _mm256_storeu_si256((__m256i *)Lanes, Acc);
+  for (i = 0; i < 8; i++) NewSum += Lanes[i];
+#elif defined(__SSE2__)
+  __m128i Acc = _mm_setzero_si128();
+
+  for (; Count >= 16; Count -= 16, pStart += 16)
+  {
+    __m128i Words = _mm_loadu_si128((const __m128i *)pStart);
+
+    Acc = _mm_add_epi32(Acc, _mm_unpacklo_epi16(Words, _mm_setzero_si128()));
+    Acc = _mm_add_epi32(Acc, _mm_unpackhi_epi16(Words, _mm_setzero_si128()));
+  }
+  _mm_storeu_si128((__m128i *)Lanes, Acc);
+  for (i = 0; i < 4; i++) NewSum += Lanes[i];
+#else
+  (void)Lanes;
+  (void)i;
+#endif
+
+  for (; Count > 1; Count -= 2, pStart += 2)     // words left
+    NewSum += pStart[0] | pStart[1] << 8;
+
+  if (Count)                                     // add left-over byte, if any
+    NewSum += *pStart;
+
+  while (NewSum >> 16)
+    NewSum = (NewSum & 0xffff) + (NewSum >> 16);
+
+  return NewSum;
+}
+//------------------------------------------------------------------------------
+// ChecksumAdd() as a plain C loop (a 32 bit add per word), for comparison.
+// not vectorized by the compiler, just like on the MSP430.
+//------------------------------------------------------------------------------
+__attribute__((optimize("no-tree-vectorize")))
+static unsigned int ChecksumAddC(const void *Start, unsigned int Count, unsigned int Sum)
+{
+  unsigned long NewSum = Sum;
+  const unsigned int *pStart = Start;
+
+  while (Count > 1)
+  {
+    NewSum += *pStart++;
+    Count -= 2;
+  }
+
+  if (Count)
+    NewSum += *(const unsigned char *)pStart;
+
+  while (NewSum >> 16)
+    NewSum = (NewSum & 0xffff) + (NewSum >> 16);
+
+  return NewSum;
+}
+//------------------------------------------------------------------------------
+// EASYWEB_BENCHMARK: times ChecksumAdd() against the C loop for the payload
+// sizes of the target's CHECKSUM_BENCHMARK (plus odd ones) and checks that
+// both return the same sum
+//------------------------------------------------------------------------------
+static void HostBenchmark(void)
+{
+  static const unsigned Sizes[] = { 20, 64, 255, 256, 576, 1024, 1499, 1500 };
+  static unsigned int Data[1500 / 2];
+  volatile unsigned int Sink = 0;
+  struct timespec Begin, End;
+  double Time[2];
+  unsigned i, j, Run;
+
+  for (i = 0; i < 1500 / 2; i++)
+    Data[i] = rand();
+
+  fprintf(stderr, "easyWEB host: ChecksumAdd() benchmark (ns per byte)\n"
+    "  bytes     C loop  %-9s speedup\n",
+#if defined(__AVX2__)
+    "AVX2");
+#elif defined(__SSE2__)
+    "SSE2");
+#else
+    "C");
+#endif
+
+  for (i = 0; i < sizeof Sizes / sizeof Sizes[0]; i++)
+  {
+    for (j = 0; j < 2; j++)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &Begin);
+      for (Run = 0; Run < HOST_BENCHMARK_RUNS; Run++)
+        Sink += (j ? ChecksumAdd : ChecksumAddC)(Data, Sizes[i], Run);
+      clock_gettime(CLOCK_MONOTONIC, &End);
+      Time[j] = ((End.tv_sec - Begin.tv_sec) * 1e9 + (End.tv_nsec - Begin.tv_nsec)) /
+        HOST_BENCHMARK_RUNS / Sizes[i];
+    }
+
+    fprintf(stderr, "  %5u  %9.3f  %9.3f  %6.1fx%s\n", Sizes[i], Time[0], Time[1],
+      Time[0] / Time[1],
+      ChecksumAdd(Data, Sizes[i], 0) == ChecksumAddC(Data, Sizes[i], 0) ? "" : "  MISMATCH");
+  }
+}
@@ -0,0 +1,155 @@
+//------------------------------------------------------------------------------
+// Name: msp430x14x.h (host)
+// Func: stand-in for the MSP430x14x device header, used when building
+//       the easyWEB stack natively on a Linux host (see Debug__Host)
+// Ver.: 1.1
+// Date: October 2026
+// Rem.: - Must be included BEFORE any other easyWEB header and AFTER all
+//         C library headers of a translation unit (see data model below).
+//       - Only the registers and bits used by easyWEB are provided.
+//------------------------------------------------------------------------------
+
+#ifndef __MSP430X14X_HOST_H
+#define __MSP430X14X_HOST_H
+
+// MSP430 data model: 'int' is 16 bit, 'long' is 32 bit. easyWEB depends on
+// this everywhere (ACCESS_UINT, SWAPB, ChecksumAdd...), so the host build
+// maps it onto the LP64 types. A plain 'unsigned' is still the 32 bit host
+// int, which is exactly what 'unsigned long' has to be.
+#define int                  short
+#define long
+
+// the stack contains some inline MSP430 assembly (WriteDWBE, ChecksumAdd),
+// the host build provides C replacements instead (msp430_host.c)
+#define asm(Text)
+
+// interrupts are emulated by msp430_host.c: the ISRs run asynchronously
+// (from a signal handler) between two CS8900A bus cycles, as long as GIE
+// is set in 'HostSR'. '#pragma vector' is ignored, see the vector table
+// in msp430_host.c instead. setting CPUOFF blocks the main program until
+// an ISR clears it in the SR saved on its entry ('HostSavedSR').
+extern volatile unsigned int HostSR;             // status register
+extern volatile unsigned int HostSavedSR;        // SR of the interrupted program
+void HostBisSR(unsigned int Bits);
+extern volatile unsigned char HostBusCycle;      // set during a CS8900A bus cycle
+void HostBusCycleEnd(void);
+#define __interrupt
+
+// compiler intrinsics
+#define __swap_bytes(Word)   ((unsigned int)(((Word) << 8) | ((unsigned int)(Word) >> 8)))
+#define __delay_cycles(Cycles)
+#define __no_operation()
+#define __enable_interrupt()    (HostSR |= GIE)
+#define __disable_interrupt()   (HostSR &= ~GIE)
+#define __bic_SR_register(Bits) (HostSR &= ~(Bits))
+#define __bis_SR_register(Bits) HostBisSR(Bits)
+#define __bic_SR_register_on_exit(Bits) (HostSavedSR &= ~(Bits))
+
+// interrupt vectors
+#define PORT2_VECTOR         (1 * 2u)
+#define TIMERA1_VECTOR       (5 * 2u)
+#define ADC12_VECTOR         (7 * 2u)
+#define TIMERB1_VECTOR       (12 * 2u)
+
+// status register bits
+#define GIE                  (0x0008)
+#define CPUOFF               (0x0010)
+#define OSCOFF               (0x0020)
+#define SCG0                 (0x0040)
+#define SCG1                 (0x0080)
+#define LPM3_bits            (SCG1 + SCG0 + CPUOFF)
+
+// special function registers
+extern volatile unsigned char IE1;
+extern volatile unsigned char IFG1;
+#define OFIFG                (0x02)
+
+// watchdog timer
+extern volatile unsigned int WDTCTL;
+#define WDTPW                (0x5A00)
+#define WDTHOLD              (0x0080)
+
+// basic clock system
+extern volatile unsigned char DCOCTL;
+extern volatile unsigned char BCSCTL1;
+extern volatile unsigned char BCSCTL2;
+#define XTS                  (0x40)
+#define DIVA0                (0x10)
+#define DIVA1                (0x20)
+#define SELM_3               (0xC0)
+
+// digital I/O
+extern volatile unsigned char P1IN, P1OUT, P1DIR, P1SEL, P1IFG, P1IES, P1IE;
+extern volatile unsigned char P2IN, P2OUT, P2DIR, P2SEL, P2IFG, P2IES, P2IE;
+extern volatile unsigned char P3IN, P3OUT, P3DIR, P3SEL;
+extern volatile unsigned char P4IN, P4OUT, P4DIR, P4SEL;
+extern volatile unsigned char P5IN, P5OUT, P5DIR, P5SEL;
+extern volatile unsigned char P6IN, P6OUT, P6DIR, P6SEL;
+
+// Timer_A
+// TAR counts ACLK / 8 = 250 kHz of host time, reading TAIV resets the
+// flag it reports (see msp430_host.c). TAR and TAIFG are always in step.
+extern volatile unsigned int TACTL;
+extern volatile unsigned int CCTL1;
+extern volatile unsigned int CCR1;
+extern volatile unsigned int *HostTAR(void);
+extern volatile unsigned int *HostTAIV(void);
+#define TAR                  (*HostTAR())
+#define TAIV                 (*HostTAIV())
+#define TAIFG                (0x0001)
+#define TAIE                 (0x0002)
+#define TACLR                (0x0004)
+#define MC_1                 (0x0010)
+#define MC_2                 (0x0020)
+#define ID_3                 (0x00C0)
+#define TASSEL_1             (0x0100)
+#define CCIFG                (0x0001)
+#define CCIE                 (0x0010)
+
+// Timer_B
+// only emulated as the trigger of the ADC12 (Timer_B.OUT1): up mode with
+// ACLK / 8 and OUTMOD_7, one rising edge per period, and the flag of
+// TBCCR1 (see msp430_host.c)
+extern volatile unsigned int TBCTL;
+extern volatile unsigned int TBCCTL1;
+extern volatile unsigned int TBCCR0;
+extern volatile unsigned int TBCCR1;
+#define TBCLR                (0x0004)
+#define TBSSEL_1             (0x0100)
+#define OUTMOD_7             (0x00E0)
+
+// ADC12
+// setting ADC12SC completes the conversion immediately. in sequence-of-
+// channels mode with MSC a rising edge of Timer_B.OUT1 converts the whole
+// sequence (see msp430_host.c). reading ADC12MEMx resets its flag in ADC12IFG.
+extern volatile unsigned int *HostADC12CTL0(void);
+extern volatile unsigned int *HostADC12MEM(unsigned char Index);
+#define ADC12CTL0            (*HostADC12CTL0())
+extern volatile unsigned int ADC12CTL1;
+extern volatile unsigned char ADC12MCTL[16];
+#define ADC12MCTL0           (ADC12MCTL[0])
+#define ADC12MCTL1           (ADC12MCTL[1])
+#define ADC12MEM0            (*HostADC12MEM(0))
+#define ADC12MEM1            (*HostADC12MEM(1))
+extern volatile unsigned int ADC12IFG;
+extern volatile unsigned int ADC12IE;
+#define ADC12SC              (0x0001)
+#define ENC                  (0x0002)
+#define ADC12ON              (0x0010)
+#define REFON                (0x0020)
+#define REF2_5V              (0x0040)
+#define MSC                  (0x0080)
+#define SHT0_6               (0x0600)
+#define SHS_0                (0x0000)
+#define SHS_3                (0x0C00)
+#define SHP                  (0x0200)
+#define CONSEQ_0             (0x0000)
+#define CONSEQ_1             (0x0002)
+#define CONSEQ_3             (0x0006)
+#define SREF_1               (0x10)
+#define SREF_7               (0x70)
+#define EOS                  (0x80)
+#define INCH_7               (7)
+#define INCH_10              (10)
+
+#endif
@@ -0,0 +1,451 @@
+//------------------------------------------------------------------------------
+// Name: sim8900.c
+// Func: software model of the CS8900A in 8 bit I/O mode, as seen from the
+//       ISA bus of the MSP430 (host build only)
+// Ver.: 1.1
+// Date: October 2026
+// Rem.: - models the PacketPage registers used by easyWEB, the RX/TX
+//         frame ports, the TxCMD/TxLength bid and the ISQ with INTRQ0,
+//         backed by in-memory frame queues
+//       - a received frame is reported once (ISQ or RxEvent) and stays
+//         at RX_FRAME_PORT until it is skipped (Skip_1 or implied skip)
+//       - every IOR/IOW strobe of the real bus is one call of
+//         Sim8900ReadIO()/Sim8900WriteIO()
+//------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "cs8900.h"
+#include "sim8900.h"
+
+#define PP_SIZE              4096                // PacketPage memory space
+
+// typedefs
+typedef struct
+{
+  uint16_t Event;                                // RxEvent for this frame
+  uint16_t Size;
+  uint8_t Data[SIM_MAX_FRAME_SIZE];
+} TSimFrame;
+
+typedef struct
+{
+  TSimFrame Frame[SIM_QUEUE_SIZE];
+  unsigned Head;                                 // oldest frame
+  unsigned Count;
+} TSimQueue;
+
+// exported variables
+TSim8900Stats Sim8900Stats;
+
+// variables
+static uint8_t PacketPage[PP_SIZE];              // register file (little-endian)
+static uint16_t PPPointer;                       // PacketPage pointer (ADD_PORT)
+static uint16_t DataLatch;                       // word being xfered via DATA_PORT
+static uint16_t TxCMDLatch;                      // word being xfered via TX_CMD_PORT
+static uint16_t TxLenLatch;                      // word being xfered via TX_LEN_PORT
+static uint16_t ISQLatch;
+
+static TSimQueue RxQueue;                        // frames received from the network
+static TSimQueue TxQueue;                        // frames sent by the MCU
+
+static TSimFrame RxFrame;                        // frame accessible at RX_FRAME_PORT
+static unsigned RxReadPos;                       // next byte of RxStatus, RxLength, data
+static unsigned char RxReported;                 // its RxEvent has been read
+
+static TSimFrame TxFrame;                        // frame written to TX_FRAME_PORT
+static unsigned TxWritePos;
+static unsigned char TxBidOK;                    // TxLength accepted, waiting for data
+
+static void (*ServiceHook)(void);
+
+// local function prototypes
+static void Reset(void);
+static uint16_t PeekPP(uint16_t Address);
+static uint16_t ReadPP(uint16_t Address);
+static void WritePP(uint16_t Address, uint16_t Data);
+static void TxBid(uint16_t Length);
+static void RxSkip(void);
+static uint16_t NextISQEvent(unsigned char Remove);
+//------------------------------------------------------------------------------
+// hardware reset (POWER_ON_RESET)
+//------------------------------------------------------------------------------
+static void Reset(void)
+{
+  memset(PacketPage, 0, sizeof PacketPage);
+  PPPointer = 0;
+  RxFrame.Size = 0;
+  RxReadPos = 0;
+  TxBidOK = 0;
+
+  WritePP(PP_ChipID, 0x630e);                    // Crystal Semiconductor
+  WritePP(PP_ChipID + 2, 0x0a00);                // CS8900A rev. B
+  WritePP(PP_CS8900_ISAINT, 0x0004);             // all INTRQ pins off
+  WritePP(PP_SelfST, INIT_DONE);
+  WritePP(PP_LineST, LINK_OK | TENBASET_ON);
+}
+//------------------------------------------------------------------------------
+// reads a PacketPage register without side-effects
+//------------------------------------------------------------------------------
+static uint16_t PeekPP(uint16_t Address)
+{
+  return PacketPage[Address] | (PacketPage[Address + 1] << 8);
+}
+//------------------------------------------------------------------------------
+// reads a PacketPage register, including its side-effects
+//------------------------------------------------------------------------------
+static uint16_t ReadPP(uint16_t Address)
+{
+  uint16_t Value;
+
+  Address &= PP_SIZE - 2;
+  Value = PeekPP(Address);
+
+  switch (Address)
+  {
+    case PP_RxEvent :                            // implied skip of the reported frame,
+      if (ServiceHook) ServiceHook();            // then report the next one
+      if (RxReported) RxSkip();
+      RxReported = RxFrame.Size != 0;
+      Value = RxFrame.Size ? RxFrame.Event : 0;
+      break;
+    case PP_TxEvent :                            // event registers clear on read
+    case PP_BufEvent :
+      PacketPage[Address] = 0;
+      PacketPage[Address + 1] = 0;
+      break;
+    case PP_BusST :
+      if (TxBidOK) Value |= READY_FOR_TX_NOW;
+      break;
+  }
+
+  if (Address >= PP_ISQ && Address <= PP_TDR)    // register nr. in bits 0..5
+    Value |= Address - PP_ISQ;
+
+  return Value;
+}
+//------------------------------------------------------------------------------
+// writes a PacketPage register, including its side-effects
+//------------------------------------------------------------------------------
+static void WritePP(uint16_t Address, uint16_t Data)
+{
+  Address &= PP_SIZE - 2;
+
+  switch (Address)
+  {
+    case PP_SelfCTL :
+      if (Data & POWER_ON_RESET)
+      {
+        Reset();
+        return;
+      }
+      break;
+    case PP_RxCFG :
+      if (Data & SKIP_1)                         // discard the frame at RX_FRAME_PORT
+      {
+        RxSkip();
+        Data &= ~SKIP_1;
+      }
+      break;
+    case PP_TxCommand :
+      WritePP(PP_TxCMD, Data);
+      break;
+    case PP_TxLength :
+      TxBid(Data);
+      break;
+  }
+
+  PacketPage[Address] = Data;
+  PacketPage[Address + 1] = Data >> 8;
+}
+//------------------------------------------------------------------------------
+// the MCU requests buffer space for a frame of 'Length' bytes
+//------------------------------------------------------------------------------
+static void TxBid(uint16_t Length)
+{
+  uint16_t BusST = PeekPP(PP_BusST);
+
+  BusST &= ~TX_BID_ERROR;
+  TxBidOK = 0;
+
+  if (Length == 0 || Length > SIM_MAX_FRAME_SIZE || (PeekPP(PP_SelfCTL) & SLEEP_ON))
+  {
+    BusST |= TX_BID_ERROR;
+    Sim8900Stats.TxBidErrors++;
+  }
+  else if (TxQueue.Count < SIM_QUEUE_SIZE)       // else buffer space is not available
+  {
+    TxFrame.Size = Length;
+    TxWritePos = 0;
+    TxBidOK = 1;
+  }
+
+  PacketPage[PP_BusST] = BusST;
+  PacketPage[PP_BusST + 1] = BusST >> 8;
+}
+//------------------------------------------------------------------------------
+// discards the frame at RX_FRAME_PORT and latches the next one, if any
+//------------------------------------------------------------------------------
+static void RxSkip(void)
+{
+  RxFrame.Size = 0;
+  RxReadPos = 0;
+  RxReported = 0;
+
+  if (RxQueue.Count)
+  {
+    RxFrame = RxQueue.Frame[RxQueue.Head];
+    RxQueue.Head = (RxQueue.Head + 1) % SIM_QUEUE_SIZE;
+    RxQueue.Count--;
+    Sim8900Stats.RxFrames++;
+    Sim8900Stats.RxBytes += RxFrame.Size;
+  }
+}
+//------------------------------------------------------------------------------
+// returns the next event of the Interrupt Status Queue (0 if there is none)
+// and optionally removes it. only events enabled in the matching
+// configuration register are queued, a received frame is queued once.
+//------------------------------------------------------------------------------
+static uint16_t NextISQEvent(unsigned char Remove)
+{
+  uint16_t Event;
+
+  if (RxFrame.Size && !RxReported && (RxFrame.Event & PeekPP(PP_RxCFG) & RX_OK_ENBL))
+  {
+    if (Remove) RxReported = 1;
+    return RxFrame.Event;
+  }
+
+  Event = PeekPP(PP_TxEvent) & PeekPP(PP_TxCFG) & ~ISQ_EVENT_MASK;
+  if (Event)
+  {
+    if (Remove) WritePP(PP_TxEvent, 0);
+    return Event | ISQ_TX_EVENT;
+  }
+
+  Event = PeekPP(PP_BufEvent) & PeekPP(PP_BufCFG) & ~ISQ_EVENT_MASK;
+  if (Event)
+  {
+    if (Remove) WritePP(PP_BufEvent, 0);
+    return Event | ISQ_BUFFER_EVENT;
+  }
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+// ISA-bus write cycle (one IOW strobe)
+//------------------------------------------------------------------------------
+void Sim8900WriteIO(uint8_t Address, uint8_t Data)
+{
+  unsigned char HighByte = Address & 1;
+
+  Sim8900Stats.IOWrites++;
+
+  switch (Address & 0x0e)
+  {
+    case TX_FRAME_PORT :
+    case TX_FRAME_PORT + 2 :
+      if (!TxBidOK) break;                       // no buffer, data is lost
+
+      TxFrame.Data[TxWritePos++] = Data;
+
+      if (TxWritePos == TxFrame.Size)            // frame complete, send it
+      {
+        TxQueue.Frame[(TxQueue.Head + TxQueue.Count) % SIM_QUEUE_SIZE] = TxFrame;
+        TxQueue.Count++;
+        TxBidOK = 0;
+        WritePP(PP_TxEvent, TX_OK);
+        Sim8900Stats.TxFrames++;
+        Sim8900Stats.TxBytes += TxFrame.Size;
+        if (ServiceHook) ServiceHook();          // put it on the wire
+      }
+      break;
+    case TX_CMD_PORT :
+      if (HighByte) WritePP(PP_TxCommand, (TxCMDLatch & 0x00ff) | (Data << 8));
+      else TxCMDLatch = Data;
+      break;
+    case TX_LEN_PORT :
+      if (HighByte) WritePP(PP_TxLength, (TxLenLatch & 0x00ff) | (Data << 8));
+      else TxLenLatch = Data;
+      break;
+    case ADD_PORT :
+      if (HighByte) PPPointer = (PPPointer & 0x00ff) | (Data << 8);
+      else PPPointer = (PPPointer & 0xff00) | Data;
+      break;
+    case DATA_PORT :
+    case DATA_PORT + 2 :
+      if (HighByte)
+      {
+        WritePP(PPPointer & ~AUTOINCREMENT, (DataLatch & 0x00ff) | (Data << 8));
+        if (PPPointer & AUTOINCREMENT)
+          PPPointer = (PPPointer + 2) | AUTOINCREMENT;
+      }
+      else
+        DataLatch = Data;
+      break;
+  }
+}
+//------------------------------------------------------------------------------
+// ISA-bus read cycle (one IOR strobe)
+//------------------------------------------------------------------------------
+uint8_t Sim8900ReadIO(uint8_t Address)
+{
+  unsigned char HighByte = Address & 1;
+  uint8_t Value = 0;
+
+  Sim8900Stats.IOReads++;
+
+  switch (Address & 0x0e)
+  {
+    case RX_FRAME_PORT :                         // RxStatus and RxLength come
+    case RX_FRAME_PORT + 2 :                     // high-byte 1st (AN181), then data
+      if (!RxFrame.Size) break;
+
+      if (RxReadPos < 4)
+      {
+        uint16_t Word = RxReadPos < 2 ? RxFrame.Event : RxFrame.Size;
+        Value = RxReadPos & 1 ? Word : Word >> 8;
+      }
+      else if (RxReadPos - 4 < RxFrame.Size)
+        Value = RxFrame.Data[RxReadPos - 4];
+
+      RxReadPos++;
+      break;
+    case TX_CMD_PORT :
+      Value = HighByte ? PacketPage[PP_TxCMD + 1] : PacketPage[PP_TxCMD];
+      break;
+    case ISQ_PORT :
+      if (!HighByte) ISQLatch = NextISQEvent(1); // low byte 1st
+      Value = HighByte ? ISQLatch >> 8 : ISQLatch;
+      break;
+    case ADD_PORT :
+      Value = HighByte ? PPPointer >> 8 : PPPointer;
+      break;
+    case DATA_PORT :
+    case DATA_PORT + 2 :
+      if (HighByte)
+      {
+        Value = DataLatch >> 8;
+        if (PPPointer & AUTOINCREMENT)
+          PPPointer = (PPPointer + 2) | AUTOINCREMENT;
+      }
+      else
+      {
+        DataLatch = ReadPP(PPPointer & ~AUTOINCREMENT);
+        Value = DataLatch;
+      }
+      break;
+  }
+
+  return Value;
+}
+//------------------------------------------------------------------------------
+// passes a frame from the network to the CS8900A. the frame is checked
+// against the receive filter set up in PP_RxCTL, just like the real chip.
+// in sleep mode all frames are lost, with AUTO_WAKEUP the first one wakes
+// the chip up. returns 0 if the frame was dropped.
+//------------------------------------------------------------------------------
+unsigned Sim8900PutRxFrame(const uint8_t *Frame, unsigned Size)
+{
+  static const uint8_t Broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  uint16_t RxCTL = PeekPP(PP_RxCTL);
+  uint16_t SelfCTL = PeekPP(PP_SelfCTL);
+  uint16_t Event;
+  TSimFrame *pFrame;
+
+  if (SelfCTL & SLEEP_ON)
+  {
+    if (SelfCTL & AUTO_WAKEUP)                   // receive activity wakes it up
+    {
+      WritePP(PP_SelfCTL, SelfCTL & ~SLEEP_ON);
+      Sim8900Stats.AutoWakeups++;
+    }
+    Sim8900Stats.RxDropped++;
+    return 0;
+  }
+
+  if (Size < 14 || Size > SIM_MAX_FRAME_SIZE) return 0;
+
+  if (!memcmp(Frame, &PacketPage[PP_IA], 6) && (RxCTL & RX_IA_ACCEPT))
+    Event = RX_OK | RX_IA;
+  else if (!memcmp(Frame, Broadcast, 6) && (RxCTL & RX_BROADCAST_ACCEPT))
+    Event = RX_OK | RX_BROADCAST;
+  else if (RxCTL & RX_PROM_ACCEPT)
+    Event = RX_OK;
+  else
+    Event = 0;
+
+  if (!(Event && (RxCTL & RX_OK_ACCEPT)))
+  {
+    Sim8900Stats.RxDropped++;
+    return 0;
+  }
+
+  if (RxQueue.Count == SIM_QUEUE_SIZE)           // no buffer space
+  {
+    WritePP(PP_BufEvent, PeekPP(PP_BufEvent) | RX_MISS);
+    Sim8900Stats.RxDropped++;
+    return 0;
+  }
+
+  pFrame = &RxQueue.Frame[(RxQueue.Head + RxQueue.Count) % SIM_QUEUE_SIZE];
+  memcpy(pFrame->Data, Frame, Size);
+
+  if (Size < SIM_MIN_FRAME_SIZE)                 // short frames are padded on the wire
+  {
+    memset(pFrame->Data + Size, 0, SIM_MIN_FRAME_SIZE - Size);
+    Size = SIM_MIN_FRAME_SIZE;
+  }
+
+  pFrame->Size = Size;
+  pFrame->Event = Event | (PP_RxEvent - PP_ISQ);
+  RxQueue.Count++;
+
+  if (!RxFrame.Size) RxSkip();                   // make it available at once
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+// fetches the oldest frame the MCU has sent, returns its size
+// (0 if there is none)
+//------------------------------------------------------------------------------
+unsigned Sim8900GetTxFrame(uint8_t *Frame)
+{
+  TSimFrame *pFrame;
+
+  if (!TxQueue.Count) return 0;
+
+  pFrame = &TxQueue.Frame[TxQueue.Head];
+  memcpy(Frame, pFrame->Data, pFrame->Size);
+  TxQueue.Head = (TxQueue.Head + 1) % SIM_QUEUE_SIZE;
+  TxQueue.Count--;
+
+  return pFrame->Size;
+}
+//------------------------------------------------------------------------------
+// returns the level of INTRQ0: high while an enabled event is queued
+//------------------------------------------------------------------------------
+unsigned Sim8900IRQ(void)
+{
+  if (!(PeekPP(PP_BusCTL) & ENABLE_IRQ) || PeekPP(PP_CS8900_ISAINT) != 0)
+    return 0;
+
+  return NextISQEvent(0) != 0;
+}
+//------------------------------------------------------------------------------
+// lets the host link exchange frames with the network. called periodically
+// by the host's interrupt logic.
+//------------------------------------------------------------------------------
+void Sim8900Service(void)
+{
+  if (ServiceHook) ServiceHook();
+}
+//------------------------------------------------------------------------------
+// sets a function that is called each time the MCU polls PP_RxEvent, has
+// sent a frame or Sim8900Service() is called. used by the host link to
+// exchange frames with the network.
+//------------------------------------------------------------------------------
+void Sim8900SetServiceHook(void (*Hook)(void))
+{
+  ServiceHook = Hook;
+}
@@ -0,0 +1,50 @@
+//------------------------------------------------------------------------------
+// Name: sim8900.h
+// Func: header-file for sim8900.c
+// Ver.: 1.1
+// Date: October 2026
+// Rem.: -
+//------------------------------------------------------------------------------
+
+#ifndef __SIM8900_H
+#define __SIM8900_H
+
+#include <stdint.h>
+
+#define SIM_MAX_FRAME_SIZE   1514                // max. frame size w/o CRC
+#define SIM_MIN_FRAME_SIZE   60                  // frames are padded to this size
+#define SIM_QUEUE_SIZE       16                  // nr. of frames per RX/TX queue
+
+// typedefs
+typedef struct                                   // counters, for profiling
+{
+  uint32_t IOReads;                              // byte accesses on the ISA bus
+  uint32_t IOWrites;
+  uint32_t RxFrames;                             // frames passed to the MCU
+  uint32_t RxBytes;
+  uint32_t RxDropped;                            // queue full or filtered out
+  uint32_t TxFrames;                             // frames sent by the MCU
+  uint32_t TxBytes;
+  uint32_t TxBidErrors;                          // TxLength rejected
+  uint32_t AutoWakeups;                          // woken up from sleep by a frame
+  uint32_t BusConflicts;                         // strobes w/ the wrong P5DIR (cs8900_host.c)
+} TSim8900Stats;
+
+// exported variables
+extern TSim8900Stats Sim8900Stats;
+
+// exported functions
+// ISA-bus side (used by the host driver instead of P3/P5)
+void Sim8900WriteIO(uint8_t Address, uint8_t Data);
+uint8_t Sim8900ReadIO(uint8_t Address);
+
+// network side (used by the host link)
+unsigned Sim8900PutRxFrame(const uint8_t *Frame, unsigned Size);
+unsigned Sim8900GetTxFrame(uint8_t *Frame);
+void Sim8900SetServiceHook(void (*Hook)(void));
+void Sim8900Service(void);
+
+// board side (INTRQ0, used by the MCU's interrupt logic)
+unsigned Sim8900IRQ(void);
+
+#endif
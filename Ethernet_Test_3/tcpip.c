@@ -33,30 +33,118 @@ const unsigned int GatewayIP[] =                 // "GWIP1.GWIP2.GWIP3.GWIP4"
   GWIP_3 + (unsigned int)(GWIP_4 << 8)
 };
 
-// variables
-static TTCPStateMachine TCPStateMachine;         // perhaps the most important var at all ;-)
-static TLastFrameSent LastFrameSent;             // retransmission type
+// our MAC and IP address in memory byte order, for the frame templates
+#define MYMAC_W0             (MYMAC_1 + (unsigned int)(MYMAC_2 << 8))
+#define MYMAC_W1             (MYMAC_3 + (unsigned int)(MYMAC_4 << 8))
+#define MYMAC_W2             (MYMAC_5 + (unsigned int)(MYMAC_6 << 8))
+#define MYIP_W0              (MYIP_1 + (unsigned int)(MYIP_2 << 8))
+#define MYIP_W1              (MYIP_3 + (unsigned int)(MYIP_4 << 8))
+
+static const unsigned int ARPFrameTemplate[(ETH_HEADER_SIZE + ARP_FRAME_SIZE) / 2] =
+{                                                // ARP request and answer, DA, opcode and
+  0, 0, 0,                                       // the target are filled in per frame
+  MYMAC_W0, MYMAC_W1, MYMAC_W2,
+  SWAPB(FRAME_ARP),
+  SWAPB(HARDW_ETH10),
+  SWAPB(FRAME_IP),
+  SWAPB(IP_HLEN_PLEN),
+  0,
+  MYMAC_W0, MYMAC_W1, MYMAC_W2,                  // sender's hardware address
+  MYIP_W0, MYIP_W1,                              // sender's protocol address
+  0, 0, 0,
+  0, 0
+};
+
+static const unsigned int ICMPReplyTemplate[ICMP_DATA_OFS / 2] =
+{                                                // ICMP echo reply, DA, total length,
+  0, 0, 0,                                       // destination and the checksums are
+  MYMAC_W0, MYMAC_W1, MYMAC_W2,                  // filled in per frame
+  SWAPB(FRAME_IP),
+  SWAPB(IP_VER_IHL),
+  0,
+  0,
+  0,
+  SWAPB((DEFAULT_TTL << 8) | PROT_ICMP),
+  0,
+  MYIP_W0, MYIP_W1,
+  0, 0,
+  SWAPB(ICMP_ECHO_REPLY << 8),
+  0
+};
+
+// sum of the constant IP header fields of 'ICMPReplyTemplate'
+#define ICMP_REPLY_IP_SUM    ((unsigned long)SWAPB(IP_VER_IHL) + \
+                              SWAPB((DEFAULT_TTL << 8) | PROT_ICMP) + MYIP_W0 + MYIP_W1)
+
+static const unsigned int UDPFrameTemplate[UDP_DATA_OFS / 2] =
+{                                                // UDP datagram, DA, total length, the
+  0, 0, 0,                                       // destination, ports, length and the
+  MYMAC_W0, MYMAC_W1, MYMAC_W2,                  // checksums are filled in per frame
+  SWAPB(FRAME_IP),
+  SWAPB(IP_VER_IHL),
+  0,
+  0,
+  0,
+  SWAPB((DEFAULT_TTL << 8) | PROT_UDP),
+  0,
+  MYIP_W0, MYIP_W1,
+  0, 0,
+  0,
+  0,
+  0,
+  0
+};
+
+// sum of the constant IP header fields of 'UDPFrameTemplate'
+#define UDP_FRAME_IP_SUM     ((unsigned long)SWAPB(IP_VER_IHL) + \
+                              SWAPB((DEFAULT_TTL << 8) | PROT_UDP) + MYIP_W0 + MYIP_W1)
+
+static const unsigned int BroadcastMAC[3] = { 0xffff, 0xffff, 0xffff };
 
-static unsigned int ISNGenHigh;                  // upper word of our Initial Sequence Number
-static unsigned long TCPSeqNr;                   // next sequence number to send
-static unsigned long TCPUNASeqNr;                // last unaknowledged sequence number
+// variables
+static TTCPSocket TCPSockets[TCP_MAX_SOCKETS];   // connection table
+static TUDPSocket UDPSockets[UDP_MAX_SOCKETS];   // bound UDP ports
+TTCPSocket *TCPSocket;                           // selected socket (user or stack)
+
+// state of the selected socket, used by the stack internally
+#define TCPStateMachine      (TCPSocket->State)  // perhaps the most important var at all ;-)
+#define LastFrameSent        (TCPSocket->LastFrame)  // retransmission type
+#define TCPSeqNr             (TCPSocket->SeqNr)  // oldest unacknowledged sequence number
+                                                 // (next to send if nothing is in flight)
+#define TCPUNASeqNr          (TCPSocket->UNASeqNr)   // last unaknowledged sequence number
                                                  // incremented AFTER sending data
-static unsigned long TCPAckNr;                   // next seq to receive and ack to send
+#define TCPAckNr             (TCPSocket->AckNr)  // next seq to receive and ack to send
                                                  // incremented AFTER receiving data
-static unsigned char TCPTimer;                   // inc'd each 262ms
-static unsigned char RetryCounter;               // nr. of retransmissions
+#define TxSegEnd             (TCPSocket->SegEnd) // end of each data segment in flight
+#define TxSegHead            (TCPSocket->SegHead)    // oldest segment in flight
+#define TxSegCount           (TCPSocket->SegCount)   // nr. of segments in flight
+#define TCPSndWnd            (TCPSocket->SndWnd) // window advertised by the other TCP
+#define RetryCounter         (TCPSocket->Retries)    // nr. of retransmissions
+#define TCPFlags             (TCPSocket->Flags)
+#define TCPTimerElapsed      ((unsigned int)(TCPTimer - TCPSocket->TimerStart))
+
+static volatile unsigned int ISNGenHigh;         // upper word of our Initial Sequence Number
+static volatile unsigned int TCPTimer;           // inc'd each 'TCP_TICK' (10ms)
+static volatile unsigned int TCPWakeupTicks;     // ticks until TCPIdle() has to return
+static unsigned char TCPBusy;                    // the stack or the user did something,
+                                                 // TCPIdle() must not sleep yet
+static unsigned int LastTrafficTime;             // 'TCPTimer' when the last frame went in/out
+static unsigned long IdleEndTime;                // TCPClock() when TCPIdle() last returned
+TTCPPowerStats TCPPowerStats;
+volatile unsigned char TCPUserEvent;             // an ISR has work for the main loop
+static unsigned long TxFrame1SeqNr;              // sequence number of TxFrame1's data
+static TTCPSocket *TxFrame1Socket;               // owner of TxFrame1
+static TTCPSocket *TxFrame2Socket;               // owner of TxFrame2 (0: no TCP frame)
 
 static unsigned int TxFrame1Size;                // bytes to send in TxFrame1
+static unsigned int TxFrame1DataSum;             // one's complement sum of TxFrame1's data
+static const unsigned char *TxFrame1Const;       // data sent behind TxFrame1 (flash)
+static unsigned int TxFrame1ConstCount;          // (see TCPTransmitConst())
 static unsigned char TxFrame2Size;               // bytes to send in TxFrame2
 static unsigned char TransmitControl;
-static unsigned char TCPFlags;
-unsigned int TCPRxDataCount;                     // nr. of bytes rec'd
 unsigned int TCPTxDataCount;                     // nr. of bytes to send
-unsigned int TCPLocalPort;                       // TCP ports
-unsigned int TCPRemotePort;
-unsigned int RemoteMAC[3];                       // MAC and IP of current TCP-session
-unsigned int RemoteIP[2];
-unsigned char SocketStatus;
+static unsigned int TxBufSum;                    // one's complement sum of the 1st
+static unsigned int TxBufSumCount;               // 'TxBufSumCount' bytes in TCP_TX_BUF
 
 // properties of the just received frame
 static unsigned int RecdFrameLength;             // CS8900 reported frame length
@@ -64,29 +152,97 @@ static unsigned int RecdFrameMAC[3];             // 48 bit MAC
 static unsigned int RecdFrameIP[2];              // 32 bit IP
 static unsigned int RecdIPFrameLength;           // 16 bit IP packet length
 
+// receive ring: one record per segment, a header word ('RX_REC_...')
+// followed by the data (padded to an even size). records never wrap.
+static unsigned int RxRingHead;                  // offset of the oldest record
+static unsigned int RxRingTail;                  // offset of the next record
+static unsigned int RxRingUsed;                  // bytes occupied (incl. headers)
+
+// segment passed to a receive handler (see TCPReadRx())
+static unsigned int RxStreamLeft;                // bytes the handler hasn't read yet
+static unsigned int RxStreamSum;                 // checksum of the bytes read so far
+static unsigned char RxStreamOdd;                // high-byte of the last word read, but
+static unsigned char RxStreamByte;               // not passed to the handler yet
+
+static TARPCacheEntry ARPCache[ARP_CACHE_SIZE];  // IP-to-MAC translations
+static unsigned int ARPAgingStart;               // 'TCPTimer' at the last aging
+
 // the next 3 buffers must be word-aligned!
-unsigned int TxFrame1Mem[(ETH_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE +
-                          MAX_TCP_TX_DATA_SIZE + 1) >> 1];
+unsigned int TxFrame1Mem[(TCP_TX_BUF_SIZE + 1) >> 1];  // data of TxFrame1 (the header is
+                                                       // the socket's 'Header')
 static unsigned int TxFrame2Mem[(ETH_HEADER_SIZE + MAX_ETH_TX_DATA_SIZE + 1) >> 1];
-unsigned int RxTCPBufferMem[(MAX_TCP_RX_DATA_SIZE + 1) >> 1];  // space for incoming TCP-data
+unsigned int RxTCPBufferMem[TCP_RX_BUF_SIZE ? (TCP_RX_BUF_SIZE + 1) >> 1 : 1];  // space for
+                                                 // incoming TCP-data
+
+#ifdef CHECKSUM_BENCHMARK
+TChecksumBenchmark ChecksumBenchmarkResult;      // for the debugger
+
+static const unsigned int ChecksumBenchmarkSize[CHECKSUM_BENCHMARK_SIZES] =
+{
+  20, 64, 256, 576, 1024, 1500                   // IP header ... max. Ethernet payload
+};
+static const unsigned int ChecksumBenchmarkData[1500 / 2] = { 0 };  // (flash)
+
+static void BenchmarkChecksum(void);
+static unsigned int ChecksumBenchmarkRun(unsigned int (*Add)(const void *, unsigned int,
+  unsigned int), unsigned int Count);
+static unsigned int ChecksumAddC(const void *Start, unsigned int Count, unsigned int Sum);
+#endif
 //------------------------------------------------------------------------------
 // CHASE: added asembly function writeDwbe
 void WriteDWBE(unsigned char *Add, unsigned long Data);
+unsigned int ChecksumAdd(const void *Start, unsigned int Count,  // (assembly as well)
+  unsigned int Sum);
 
 // Handlers for incoming frames
 static void ProcessEthBroadcastFrame(void);
 static void ProcessEthIAFrame(void);
 static void ProcessICMPFrame(void);
 static void ProcessTCPFrame(void);
+static void ProcessUDPFrame(void);
 
 // fill TX-buffers
-static void PrepareARP_REQUEST(void);
+static void PrepareARP_REQUEST(const unsigned int *TargetIP);
 static void PrepareARP_ANSWER(void);
-static void PrepareICMP_ECHO_REPLY(void);
+static void PrepareICMP_ECHO_REPLY(unsigned int HeaderSum);
 
 static void PrepareTCP_FRAME(unsigned long seqnr, unsigned long acknr,
   unsigned int TCPCode);
 static void PrepareTCP_DATA_FRAME(void);
+static void SendFrame1(void);
+static void SendFrame2(void);
+static void CopyTemplate(const unsigned int *Template, unsigned int Count);
+static void TCPBuildHeader(void);
+static void TCPCompleteHeader(unsigned int *Header, unsigned long SeqNr, unsigned long AckNr,
+  unsigned int Code, unsigned int Window, unsigned int Length, unsigned int DataSum);
+
+// connection table
+static void TCPPollSocket(void);
+static unsigned char TCPDemultiplex(unsigned int SourcePort, unsigned int DestPort,
+  unsigned int TCPCode);
+static const unsigned int *NextHopIP(const unsigned int *IP);
+
+// receive ring
+static unsigned int RxRingReserve(unsigned int Count);
+static void RxRingPut(unsigned int Ofs, unsigned int Count);
+static void RxRingRelease(unsigned char All);
+static unsigned int TCPRxWindow(void);
+static unsigned char TCPRxAcceptable(unsigned long SegSeq, unsigned long SegAck,
+  unsigned int TCPCode);
+static unsigned int TCPStreamRx(unsigned int Count, unsigned int Sum);
+static void RxStreamBegin(unsigned int Count, unsigned int Sum);
+static unsigned int RxStreamEnd(void);
+static void TCPWindowUpdate(void);
+
+// low-power idle
+static unsigned int TCPIdleTicks(void);
+static unsigned char TCPConnected(void);
+static unsigned long TCPClock(void);
+
+// ARP cache
+static void ARPCacheUpdate(const unsigned int *IP, const unsigned int *MAC);
+static const unsigned int *ARPCacheLookup(const unsigned int *IP);
+static void ARPCacheAging(void);
 
 // general help functions
 static void TCPStartRetryTimer(void);
@@ -95,23 +251,68 @@ static void TCPRestartTimer(void);
 static void TCPStopTimer(void);
 static void TCPHandleRetransmission(void);
 static void TCPHandleTimeout(void);
-static unsigned int CalcChecksum(void *Start, unsigned int Count,
-  unsigned char IsTCP);
+static void TCPResetTx(void);
+static void TCPAckTxSegments(unsigned long AckNr);
+static void TCPCheckTxWindow(void);
+static void TCPReleaseTxFrame1(void);
+static void TCPRewindTx(void);
+static void TCPInitRTO(void);
+static void TCPStartRTTMeasurement(void);
+static void TCPUpdateRTO(unsigned long AckNr);
+static void TCPDelayAck(void);
+static unsigned int ChecksumAddConst(const unsigned char *Start, unsigned int Count,
+  unsigned int Ofs, unsigned int Sum);
+static unsigned int PseudoSum(const unsigned int *IP, unsigned int Protocol,
+  unsigned int Length, unsigned int Sum);
+static unsigned int ChecksumFold(unsigned long Sum);
 //------------------------------------------------------------------------------
 // easyWEB-API function
 // initalizes the LAN-controller, reset flags, starts timer-ISR
 //------------------------------------------------------------------------------
 void TCPLowLevelInit(void)
 {
+  unsigned char i;
+
   BCSCTL1 &= ~DIVA0;                             // ACLK = XT1 / 4 = 2 MHz
   BCSCTL1 |= DIVA1;
   TACTL = ID_3 + TASSEL_1 + MC_2 + TAIE;         // stop timer, use ACLK / 8 = 250 kHz, gen. int.
                                                  // start timer in continuous up-mode
-  Init8900();
+  CCR1 = TAR + TCP_TICK;                         // CCR1 int. each 'TCP_TICK'
+  CCTL1 = CCIE;
+#ifdef CHECKSUM_BENCHMARK
+  BenchmarkChecksum();                           // (uses ACLK as set up above)
+#endif
+  Init8900();                                    // CS8900's INTRQ int. is enabled, too
   TransmitControl = 0;
-  TCPFlags = 0;
-  TCPStateMachine = CLOSED;
-  SocketStatus = 0;
+  RxRingUsed = 0;
+  IdleEndTime = TCPClock();
+
+  for (i = 0; i < ARP_CACHE_SIZE; i++)
+    ARPCache[i].TTL = 0;                         // ARP cache is empty
+
+  for (TCPSocket = TCPSockets; TCPSocket < TCPSockets + TCP_MAX_SOCKETS; TCPSocket++)
+  {
+    TCPFlags = 0;
+    TCPStateMachine = CLOSED;
+    SocketStatus = 0;
+    TCPRxHandler = 0;                            // data goes to the receive ring
+    TCPIdleTimeout = 0;                          // connections may idle forever
+  }
+
+  for (i = 0; i < UDP_MAX_SOCKETS; i++)
+    UDPSockets[i].LocalPort = 0;                 // no UDP port bound
+
+  TCPSelectSocket(0);
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// selects the socket (0..TCP_MAX_SOCKETS-1) the other API functions and
+// vars (SocketStatus, TCPLocalPort, RemoteIP...) refer to. socket 0 is
+// selected after TCPLowLevelInit().
+//------------------------------------------------------------------------------
+void TCPSelectSocket(unsigned char Socket)
+{
+  TCPSocket = &TCPSockets[Socket];
 }
 //------------------------------------------------------------------------------
 // easyWEB-API function
@@ -123,8 +324,11 @@ void TCPPassiveOpen(void)
   if (TCPStateMachine == CLOSED)
   {
     TCPFlags &= ~TCP_ACTIVE_OPEN;                // let's do a passive open!
+    TCPInitRTO();
+    RxRingRelease(1);                            // forget data of the last connection
     TCPStateMachine = LISTENING;
     SocketStatus = SOCK_ACTIVE;                  // reset, socket now active
+    TCPBusy = 1;
   }
 }
 //------------------------------------------------------------------------------
@@ -136,13 +340,29 @@ void TCPActiveOpen(void)
 {
   if ((TCPStateMachine == CLOSED) || (TCPStateMachine == LISTENING))
   {
+    const unsigned int *MAC = ARPCacheLookup(NextHopIP(RemoteIP));
+
     TCPFlags |= TCP_ACTIVE_OPEN;                 // let's do an active open!
-    TCPFlags &= ~IP_ADDR_RESOLVED;               // we haven't opponents MAC yet
-  
-    PrepareARP_REQUEST();                        // ask for MAC by sending a broadcast
-    LastFrameSent = ARP_REQUEST;
-    TCPStartRetryTimer();
+    TCPInitRTO();
+    RxRingRelease(1);                            // forget data of the last connection
+
+    if (MAC)                                     // opponents MAC (or gateway's) known?
+    {
+      RemoteMAC[0] = MAC[0];
+      RemoteMAC[1] = MAC[1];
+      RemoteMAC[2] = MAC[2];
+      TCPBuildHeader();
+      TCPFlags |= IP_ADDR_RESOLVED;              // SYN is sent by DoNetworkStuff()
+    }
+    else
+    {
+      TCPFlags &= ~IP_ADDR_RESOLVED;             // we haven't opponents MAC yet
+      PrepareARP_REQUEST(NextHopIP(RemoteIP));   // ask for MAC by sending a broadcast
+      LastFrameSent = ARP_REQUEST;
+      TCPStartRetryTimer();
+    }
     SocketStatus = SOCK_ACTIVE;                  // reset, socket now active    
+    TCPBusy = 1;
   }
 }
 //------------------------------------------------------------------------------
@@ -158,75 +378,458 @@ void TCPClose(void)
       TCPStateMachine = CLOSED;
       TCPFlags = 0;
       SocketStatus = 0;
+      TCPBusy = 1;
       break;
     case SYN_RECD :
     case ESTABLISHED :
       TCPFlags |= TCP_CLOSE_REQUESTED;
+      TCPBusy = 1;
       break;
   }
 }
 //------------------------------------------------------------------------------
 // easyWEB-API function
-// releases the receive-buffer and allows easyWEB to store new data
-// NOTE: rx-buffer MUST be released periodically, else the other TCP
-//       get no ACKs for the data it sent
+// releases the segment in 'TCP_RX_BUF' and allows easyWEB to store new data.
+// if more segments of this socket are queued, 'SOCK_DATA_AVAILABLE' stays
+// set and 'TCP_RX_BUF' / 'TCPRxDataCount' describe the next one.
+// NOTE: rx-buffer MUST be released periodically, else the window closes
+//       and the other TCP has to wait
 //------------------------------------------------------------------------------
 void TCPReleaseRxBuffer(void)
 {
-  SocketStatus &= ~SOCK_DATA_AVAILABLE;
+  TTCPSocket *UserSocket = TCPSocket;
+
+  RxRingRelease(0);
+
+  for (TCPSocket = TCPSockets; TCPSocket < TCPSockets + TCP_MAX_SOCKETS; TCPSocket++)
+    TCPWindowUpdate();                           // the ring is shared, tell everybody
+
+  TCPSocket = UserSocket;
+  TCPBusy = 1;
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// alternative to the receive ring: if 'TCPRxHandler' is set (before the
+// socket is opened), each in-sequence segment is passed to this function
+// as soon as it comes in: 'Count' is the nr. of data bytes, the socket is
+// selected. the handler reads the data straight from the CS8900: each
+// TCPReadRx() copies the next 'Count' bytes (or less at the end of the
+// segment) to 'Dest' and returns the nr. of bytes copied, what the handler
+// doesn't read is skipped. so a request can be parsed in place w/o any
+// receive buffer.
+// the checksum is verified after the handler returns, if the data turns
+// out to be corrupted the handler is called again with 'TCP_RX_CORRUPTED'
+// and has to forget it (the other TCP sends it again).
+// NOTE: * only to be called from within the receive handler, which must
+//         not call any other API function (the CS8900 is being read)
+//       * 'Dest' may start at any address, word-aligned is faster
+//------------------------------------------------------------------------------
+unsigned int TCPReadRx(void *Dest, unsigned int Count)
+{
+  unsigned char *pDest = Dest;
+  unsigned int Left;
+  unsigned int Word;
+
+  if (Count > RxStreamLeft) Count = RxStreamLeft;
+  RxStreamLeft -= Count;
+  Left = Count;
+
+  if (RxStreamOdd && Left)                       // high-byte of the last word
+  {                                              // comes first
+    *pDest++ = RxStreamByte;
+    RxStreamOdd = 0;
+    Left--;
+  }
+
+  if ((unsigned int)pDest & 1)                   // odd address, copy the words byte
+  {                                              // by byte and sum them afterwards
+    CopyFromFrame8900(pDest, Left & ~1);
+    RxStreamSum = ChecksumAddConst(pDest, Left & ~1, 0, RxStreamSum);
+  }
+  else
+    RxStreamSum = CopyFromFrameSum8900(pDest, Left & ~1, RxStreamSum);
+  pDest += Left & ~1;
+
+  if (Left & 1)                                  // odd count: more data behind the last
+  {                                              // byte? read the whole word and keep its
+    if (RxStreamLeft)                            // high-byte for the next call
+    {
+      Word = ReadFrame8900();
+      RxStreamSum = ChecksumFold((unsigned long)RxStreamSum + Word);
+      *pDest = (unsigned char)Word;
+      RxStreamByte = Word >> 8;
+      RxStreamOdd = 1;
+    }
+    else                                         // last byte of the segment
+    {
+      CopyFromFrame8900(pDest, 1);
+      RxStreamSum = ChecksumFold((unsigned long)RxStreamSum + *pDest);
+    }
+  }
+
+  return Count;
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// appends 'Count' bytes to the data in 'TCP_TX_BUF' and advances
+// 'TCPTxDataCount'. the bytes are added to the TCP checksum on the way,
+// so the data needn't be read again when the segment is sent.
+// NOTE: * set 'TCPTxDataCount' to 0 before writing a new segment
+//       * the source may start at any address
+//------------------------------------------------------------------------------
+void TCPWriteTxBuffer(const void *Source, unsigned int Count)
+{
+  const unsigned char *pSource = Source;
+  unsigned char *pDest = TCP_TX_BUF + TCPTxDataCount;
+  unsigned long Sum;
+  unsigned int Word;
+
+  if (TxBufSumCount != TCPTxDataCount)           // buffer was filled directly?
+    TxBufSum = ChecksumAdd(TCP_TX_BUF, TCPTxDataCount, 0);
+  Sum = TxBufSum;
+
+  if ((TCPTxDataCount & 1) && Count)             // odd offset, the 1st byte is
+  {                                              // a high-byte
+    Sum += (unsigned int)*pSource << 8;
+    *pDest++ = *pSource++;
+    TCPTxDataCount++;
+    Count--;
+  }
+
+  TCPTxDataCount += Count;
+
+  while (Count > 1)                              // copy and sum words
+  {
+    Word = *pSource++;
+    Word |= (unsigned int)*pSource++ << 8;
+    *(unsigned int *)pDest = Word;
+    pDest += 2;
+    Sum += Word;
+    Count -= 2;
+  }
+
+  if (Count)                                     // left-over byte, if any
+  {
+    *pDest = *pSource;
+    Sum += *pSource;
+  }
+
+  TxBufSum = ChecksumFold(Sum);
+  TxBufSumCount = TCPTxDataCount;
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// overwrites 'Count' bytes at offset 'Ofs' of 'TCP_TX_BUF' (e.g. to insert
+// a value into a page) and updates the checksum of TCPWriteTxBuffer()
+//------------------------------------------------------------------------------
+void TCPPatchTxBuffer(unsigned int Ofs, const void *Source, unsigned int Count)
+{
+  const unsigned char *pSource = Source;
+  unsigned int Start = Ofs & ~1;                 // words touched by the patch
+  unsigned int Size = ((Ofs + Count + 1) & ~1) - Start;
+  unsigned int Sum;
+
+  Sum = ~ChecksumAdd(TCP_TX_BUF + Start, Size, 0);  // take the old words out...
+
+  while (Count--)
+    TCP_TX_BUF[Ofs++] = *pSource++;
+
+  Sum = ChecksumAdd(TCP_TX_BUF + Start, Size, Sum); // ...and the new ones in
+  TxBufSum = ChecksumFold((unsigned long)TxBufSum + Sum);
 }
 //------------------------------------------------------------------------------
 // easyWEB-API function
 // transmitts data stored in 'TCP_TX_BUF'
 // NOTE: * number of bytes to transmit must have been written to 'TCPTxDataCount'
-//       * data-count MUST NOT exceed 'MAX_TCP_TX_DATA_SIZE'
+//         (by TCPWriteTxBuffer() or directly)
+//       * data-count MUST NOT exceed 'TCP_TX_BUF_SIZE'
+//       * the buffer is shared by all sockets. it is released again as soon
+//         as the segment has been passed to the CS8900, up to
+//         'TCP_MAX_SEGS_IN_FLIGHT' segments per socket may be
+//         unacknowledged. if a retransmission is necessary, easyWEB goes
+//         back to the oldest unacknowledged byte: 'TCPTxRewind' then holds
+//         the nr. of bytes the user has to send again. the user must step
+//         back his data pointer and clear 'TCPTxRewind' before filling the
+//         buffer.
 //------------------------------------------------------------------------------
 void TCPTransmitTxBuffer(void)
 {
+  TCPTransmitConst(0, 0);
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// transmitts the data in 'TCP_TX_BUF' ('TCPTxDataCount' bytes, may be 0)
+// followed by 'Count' bytes of constant data at 'Data' (e.g. a web page in
+// flash). the constant data isn't copied to RAM, it is read again when the
+// segment is passed to the CS8900.
+// NOTE: * 'TCPTxDataCount' + 'Count' MUST NOT exceed 'MAX_TCP_TX_DATA_SIZE'
+//       * 'Data' may start at any address and must not change until the
+//         buffer is released again (see TCPTransmitTxBuffer())
+//       * if a retransmission is necessary, the user sends the same range
+//         again ('TCPTxRewind', see above)
+//------------------------------------------------------------------------------
+void TCPTransmitConst(const void *Data, unsigned int Count)
+{
+  unsigned char i;
+
   if ((TCPStateMachine == ESTABLISHED) || (TCPStateMachine == CLOSE_WAIT))
     if (SocketStatus & SOCK_TX_BUF_RELEASED)
     {
-      SocketStatus &= ~SOCK_TX_BUF_RELEASED;               // occupy tx-buffer
-      TCPUNASeqNr += TCPTxDataCount;                       // advance UNA
-      
-      TxFrame1Size = ETH_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE + TCPTxDataCount;
+      for (i = 0; i < TCP_MAX_SOCKETS; i++)                // occupy tx-buffer
+        TCPSockets[i].Status &= ~SOCK_TX_BUF_RELEASED;
+
+      TxFrame1Socket = TCPSocket;
+      TxFrame1SeqNr = TCPUNASeqNr;
+      TCPUNASeqNr += TCPTxDataCount + Count;               // advance UNA
+
+      TxSegEnd[(TxSegHead + TxSegCount) % TCP_MAX_SEGS_IN_FLIGHT] = TCPUNASeqNr;
+      TxSegCount++;                                        // one more segment in flight
+      TCPSocket->IdleStart = TCPTimer;                     // connection isn't idle
+
+      if (TxBufSumCount != TCPTxDataCount)                 // not (only) filled by
+        TxBufSum = ChecksumAdd(TCP_TX_BUF, TCPTxDataCount, 0);  // TCPWriteTxBuffer()?
+      TxFrame1DataSum = ChecksumAddConst(Data, Count, TCPTxDataCount, TxBufSum);
+      TxBufSum = 0;
+      TxBufSumCount = 0;
+
+      TxFrame1Const = Data;
+      TxFrame1ConstCount = Count;
+      TxFrame1Size = ETH_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE + TCPTxDataCount +
+        Count;
       TransmitControl |= SEND_FRAME1;
+      TCPBusy = 1;
       
       LastFrameSent = TCP_DATA_FRAME;
-      TCPStartRetryTimer();
+      TCPStartRTTMeasurement();
+      if (!(TCPFlags & TCP_TIMER_RUNNING))                 // time the oldest segment
+        TCPStartRetryTimer();
+    }
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// binds UDP socket 'Socket' (0..UDP_MAX_SOCKETS-1) to 'LocalPort', the
+// source port of its datagrams (0 = unbind). datagrams sent to the port
+// are passed to 'RxHandler' (if not 0) as soon as they come in: 'IP' and
+// 'Port' are the sender's (IP in memory byte order), 'Count' is the nr.
+// of data bytes. like a TCP receive handler (see TCPReadRx()) it reads
+// the data straight from the CS8900 with UDPReadRx(), what it doesn't
+// read is skipped. if the checksum turns out to be wrong, the handler is
+// called again with 'UDP_RX_CORRUPTED' and has to forget the datagram.
+// NOTE: the handler must not call any other API function (it may note
+//       the sender and answer with UDPSendTo() after DoNetworkStuff())
+//------------------------------------------------------------------------------
+void UDPBind(unsigned char Socket, unsigned int LocalPort, TUDPRxHandler RxHandler)
+{
+  UDPSockets[Socket].LocalPort = LocalPort;
+  UDPSockets[Socket].RxHandler = RxHandler;
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// copies the next 'Count' bytes of the datagram being received to 'Dest'
+// and returns the nr. of bytes copied (see TCPReadRx())
+//------------------------------------------------------------------------------
+unsigned int UDPReadRx(void *Dest, unsigned int Count)
+{
+  return TCPReadRx(Dest, Count);
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// sends 'Count' bytes at 'Data' (any address, RAM or flash) as a datagram
+// from UDP socket 'Socket' to 'IP:RemotePort' ('IP' in memory byte order,
+// 255.255.255.255 = broadcast). the header is built on the stack and the
+// frame is passed to the CS8900 at once, so neither TxFrame1 nor TxFrame2
+// is needed and 'Data' may change again as soon as the function returns.
+// returns 'UDP_SENT' or why the datagram was dropped ('UDP_ERR_...'). if
+// the MAC of the next hop isn't in the ARP cache yet, an ARP-request is
+// sent instead, the caller may try again later.
+// NOTE: not to be called from within a receive handler or an ISR
+//------------------------------------------------------------------------------
+unsigned char UDPSendTo(unsigned char Socket, const unsigned int *IP,
+  unsigned int RemotePort, const void *Data, unsigned int Count)
+{
+  unsigned int Header[UDP_DATA_OFS / 2];
+  const unsigned int *MAC;
+  unsigned int Length = UDP_HEADER_SIZE + Count;
+  unsigned long Sum;
+  unsigned int Checksum;
+  unsigned char IntEnabled;
+  unsigned char i;
+
+  if (Count > MAX_UDP_TX_DATA_SIZE)
+    return UDP_ERR_SIZE;
+
+  if ((IP[0] == 0xffff) && (IP[1] == 0xffff))    // (limited) broadcast?
+    MAC = BroadcastMAC;
+  else
+  {
+    MAC = ARPCacheLookup(NextHopIP(IP));
+    if (!MAC)                                    // ask for the MAC of the next hop
+    {                                            // (no socket to blame if that fails)
+      PrepareARP_REQUEST(NextHopIP(IP));
+      TxFrame2Socket = 0;
+      TCPBusy = 1;
+      return UDP_ERR_ARP_PENDING;
     }
+  }
+
+  for (i = 0; i < UDP_DATA_OFS / 2; i++)
+    Header[i] = UDPFrameTemplate[i];
+
+  // Ethernet
+  ACCESS_UINT(*Header, ETH_DA_OFS) = MAC[0];
+  ACCESS_UINT(*Header, ETH_DA_OFS + 2) = MAC[1];
+  ACCESS_UINT(*Header, ETH_DA_OFS + 4) = MAC[2];
+
+  // IP
+  ACCESS_UINT(*Header, IP_TOTAL_LENGTH_OFS) = __swap_bytes(IP_HEADER_SIZE + Length);
+  ACCESS_UINT(*Header, IP_DESTINATION_OFS) = IP[0];
+  ACCESS_UINT(*Header, IP_DESTINATION_OFS + 2) = IP[1];
+  ACCESS_UINT(*Header, IP_HEAD_CHKSUM_OFS) = ~ChecksumFold(UDP_FRAME_IP_SUM +
+    ACCESS_UINT(*Header, IP_TOTAL_LENGTH_OFS) + IP[0] + IP[1]);
+
+  // UDP
+  ACCESS_UINT(*Header, UDP_SRCPORT_OFS) = __swap_bytes(UDPSockets[Socket].LocalPort);
+  ACCESS_UINT(*Header, UDP_DESTPORT_OFS) = __swap_bytes(RemotePort);
+  ACCESS_UINT(*Header, UDP_LENGTH_OFS) = __swap_bytes(Length);
+
+  if ((unsigned int)Data & 1)                    // sum up the data
+    Sum = ChecksumAddConst(Data, Count, 0, 0);
+  else
+    Sum = ChecksumAdd(Data, Count, 0);
+  Sum += ACCESS_UINT(*Header, UDP_SRCPORT_OFS);
+  Sum += ACCESS_UINT(*Header, UDP_DESTPORT_OFS);
+  Sum += ACCESS_UINT(*Header, UDP_LENGTH_OFS);
+  Checksum = ~PseudoSum(IP, PROT_UDP, Length, ChecksumFold(Sum));
+  ACCESS_UINT(*Header, UDP_CHKSUM_OFS) = Checksum ? Checksum : 0xffff;  // (0 = none)
+
+  IntEnabled = Int8900Enabled();                 // the bus is ours now
+  Disable8900Int();
+  LastTrafficTime = TCPTimer;
+  RequestSend(UDP_DATA_OFS + Count);
+
+  if (Rdy4Tx())                                  // (see SendFrame2())
+  {
+    CopyToFrame8900(Header, UDP_DATA_OFS);
+    CopyToFrame8900(Data, Count);
+    i = UDP_SENT;
+  }
+  else
+    i = UDP_ERR_BUSY;
+
+  if (IntEnabled) Enable8900Int();
+  return i;
 }
 //------------------------------------------------------------------------------
 // easyWEB's 'main()'-function
 // must be called from user program periodically (the often - the better)
-// handles network, TCP/IP-stack and user events
+// handles network, TCP/IP-stack and user events. a frame is only read
+// from the CS8900 if its ISQ handler has reported one (interrupts must be
+// enabled).
 //------------------------------------------------------------------------------
 void DoNetworkStuff(void)
 {
+  TTCPSocket *UserSocket = TCPSocket;            // the user's selection is restored below
   unsigned int ActRxEvent;                       // copy of cs8900's RxEvent-Register
 
-  Write8900(ADD_PORT, PP_RxEvent);               // point to RxEvent
-  ActRxEvent = Read8900(DATA_PORT);              // read, implied skip of last frame
+  Disable8900Int();                              // the bus is ours now
+  TCPBusy = 0;
 
-  if (ActRxEvent & RX_OK)
+  ActRxEvent = Events8900.RxEvent;
+  if (ActRxEvent)                                // frame pending?
   {
-    if (ActRxEvent & RX_IA) ProcessEthIAFrame();
+    BeginRead8900();                             // data bus stays an input while
+    if (ActRxEvent & RX_IA) ProcessEthIAFrame(); // the frame is read
     if (ActRxEvent & RX_BROADCAST) ProcessEthBroadcastFrame();
+    EndRead8900();
+
+    Events8900.RxEvent = 0;
+    Skip8900();                                  // done, CS8900 reports the next one
+    LastTrafficTime = TCPTimer;
+    TCPBusy = 1;
+  }
+
+  ARPCacheAging();
+
+  for (TCPSocket = TCPSockets; TCPSocket < TCPSockets + TCP_MAX_SOCKETS; TCPSocket++)
+    TCPPollSocket();                             // timers, user requests
+
+  if (TransmitControl)                           // a socket may go on after sending,
+    TCPBusy = 1;                                 // so don't sleep yet
+
+  if (TransmitControl & SEND_FRAME2) SendFrame2();
+  if (TransmitControl & SEND_FRAME1) SendFrame1();
+
+  Enable8900Int();
+  TCPSocket = UserSocket;
+}
+//------------------------------------------------------------------------------
+// easyWEB-API function
+// puts the MCU into LPM3 until the stack has something to do again: a
+// frame comes in (CS8900's INTRQ) or one of its timers expires (Timer_A).
+// returns at once if the last DoNetworkStuff() or an API function called
+// since then did something. to be called at the end of the main loop.
+// an ISR of the user that has work for the main loop sets 'TCPUserEvent'
+// and wakes the MCU on exit, so the event isn't missed if it comes in
+// just before TCPIdle() goes to sleep.
+// after 'CS8900_SLEEP_TIME' w/o traffic and connections the CS8900 is put
+// to sleep, too. 'TCPPowerStats' counts the time spent active and asleep.
+//------------------------------------------------------------------------------
+void TCPIdle(void)
+{
+  unsigned long SleepStart;
+
+  if (TCPBusy) return;
+
+  if (CS8900_SLEEP_TIME && !Sleeping8900 && !TCPConnected())
+    if ((unsigned int)(TCPTimer - LastTrafficTime) >= CS8900_SLEEP_TIME)
+    {
+      Disable8900Int();
+      Sleep8900();
+      Enable8900Int();
+    }
+
+  __disable_interrupt();
+
+  if (!Events8900.RxEvent && !TCPUserEvent)     // no frame or user event came in
+  {                                              // meanwhile?
+    TCPWakeupTicks = TCPIdleTicks();
+    SleepStart = TCPClock();
+    TCPPowerStats.Active += SleepStart - IdleEndTime;
+    __bis_SR_register(LPM3_bits + GIE);          // sleep, enable interrupts
+    __disable_interrupt();                       // (woken up by an ISR)
+    IdleEndTime = TCPClock();
+    TCPPowerStats.Asleep += IdleEndTime - SleepStart;
+    TCPPowerStats.Wakeups++;
   }
 
+  TCPUserEvent = 0;                              // the main loop runs once more
+  __enable_interrupt();
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// handles timeouts and user requests of the selected socket
+//------------------------------------------------------------------------------
+static void TCPPollSocket(void)
+{
   if (TCPFlags & TCP_TIMER_RUNNING)
   {
     if (TCPFlags & TIMER_TYPE_RETRY)
     {
-      if (TCPTimer > RETRY_TIMEOUT)
+      if (TCPTimerElapsed >= TCPSocket->RTO)
       {
         TCPRestartTimer();                       // set a new timeout
 
         if (RetryCounter)
         {
+          if (TCPSocket->RTO < TCP_MAX_RTO / 2)  // back off (RFC 6298, 5.5)
+            TCPSocket->RTO <<= 1;
+          else
+            TCPSocket->RTO = TCP_MAX_RTO;
+
           TCPHandleRetransmission();             // resend last frame
-          RetryCounter--;
-        }
+          if (LastFrameSent != TCP_WINDOW_PROBE) // the other TCP may keep its window
+            RetryCounter--;                      // closed as long as it answers the
+        }                                        // probes (RFC 1122, 4.2.2.17)
         else
         {
           TCPStopTimer();
@@ -234,13 +837,18 @@ void DoNetworkStuff(void)
         }
       }
     }
-    else if (TCPTimer > FIN_TIMEOUT)
+    else if (TCPTimerElapsed > FIN_TIMEOUT)
     {
       TCPStateMachine = CLOSED;
       TCPFlags = 0;                              // reset all flags, stop retransmission...
       SocketStatus &= SOCK_DATA_AVAILABLE;       // clear all flags but data available
     }
   }
+  if (TCPFlags & TCP_ACK_PENDING)                // delayed ACK due?
+    if ((unsigned int)(TCPTimer - TCPSocket->AckTimerStart) >= TCP_DELAYED_ACK_TIME)
+      if (!((TransmitControl & SEND_FRAME1) && (TxFrame1Socket == TCPSocket)))
+        PrepareTCP_FRAME(TCPUNASeqNr, TCPAckNr, TCP_CODE_ACK);  // no data to ride on
+
   switch (TCPStateMachine)
   {
     case CLOSED :
@@ -251,19 +859,26 @@ void DoNetworkStuff(void)
           {
             TCPSeqNr = ((unsigned long)ISNGenHigh << 16) | TAR; // set local ISN
             TCPUNASeqNr = TCPSeqNr;
+            TCPResetTx();
             TCPAckNr = 0;                                       // we don't know what to ACK!
             TCPUNASeqNr++;                                      // count SYN as a byte
             PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_SYN); // send SYN frame
             LastFrameSent = TCP_SYN_FRAME;
+            TCPStartRTTMeasurement();
             TCPStartRetryTimer();                               // we NEED a retry-timeout
             TCPStateMachine = SYN_SENT;
           }
       break;
     case SYN_RECD :
     case ESTABLISHED :
+      if (TCPSocket->IdleTimeout && (TCPStateMachine == ESTABLISHED))
+        if ((TCPSeqNr == TCPUNASeqNr) && !TCPTxRewind &&   // nothing in flight, not
+            !(TCPFlags & TCP_TIMER_RUNNING))               // waiting for the window and
+          if ((unsigned int)(TCPTimer - TCPSocket->IdleStart) >= TCPSocket->IdleTimeout)
+            TCPFlags |= TCP_CLOSE_REQUESTED;               // no data for too long?
       if (TCPFlags & TCP_CLOSE_REQUESTED)                  // user has user initated a close?
         if (!(TransmitControl & (SEND_FRAME2 | SEND_FRAME1)))   // buffers free?
-          if (TCPSeqNr == TCPUNASeqNr)                          // all data ACKed?
+          if ((TCPSeqNr == TCPUNASeqNr) && !TCPTxRewind)        // all data sent and ACKed?
           {
             TCPUNASeqNr++;
             PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_FIN | TCP_CODE_ACK);
@@ -274,7 +889,7 @@ void DoNetworkStuff(void)
       break;
     case CLOSE_WAIT :
       if (!(TransmitControl & (SEND_FRAME2 | SEND_FRAME1)))     // buffers free?
-        if (TCPSeqNr == TCPUNASeqNr)                            // all data ACKed?
+        if ((TCPSeqNr == TCPUNASeqNr) && !TCPTxRewind)          // all data sent and ACKed?
         {
           TCPUNASeqNr++;                                        // count FIN as a byte
           PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_FIN | TCP_CODE_ACK);  // we NEED a retry-timeout
@@ -284,43 +899,73 @@ void DoNetworkStuff(void)
         }
       break;
   }
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// passes TxFrame2 to the CS8900. may also be called by an API function
+// (through PrepareTCP_FRAME()...), so it masks the CS8900's int. itself.
+//------------------------------------------------------------------------------
+static void SendFrame2(void)
+{
+  unsigned char IntEnabled = Int8900Enabled();
 
-  if (TransmitControl & SEND_FRAME2)
+  Disable8900Int();
+  LastTrafficTime = TCPTimer;
+  RequestSend(TxFrame2Size);
+
+  if (Rdy4Tx())                                  // NOTE: when using a very fast MCU,
+  {                                              // maybe the CS8900 isn't ready yet
+    CopyToFrame8900((unsigned char *)TxFrame2Mem, TxFrame2Size);
+  }
+  else if (TxFrame2Socket)
   {
-    RequestSend(TxFrame2Size);
+    TxFrame2Socket->State = CLOSED;
+    TxFrame2Socket->Status = SOCK_ERR_ETHERNET;  // indicate an error to user
+    TxFrame2Socket->Flags = 0;                   // clear all flags, stop timers etc.
+  }
 
-    if (Rdy4Tx())                                // NOTE: when using a very fast MCU,
-    {                                            // maybe the CS8900 isn't ready yet
-      CopyToFrame8900((unsigned char *)TxFrame2Mem, TxFrame2Size);
+  TransmitControl &= ~SEND_FRAME2;               // clear tx-flag
+  if (IntEnabled) Enable8900Int();
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// completes the segment in TxFrame1 and passes it to the CS8900
+//------------------------------------------------------------------------------
+static void SendFrame1(void)
+{
+  unsigned int Count = TxFrame1Size - TCP_DATA_OFS - TxFrame1ConstCount;  // data in RAM
+
+  TCPSocket = TxFrame1Socket;
+  PrepareTCP_DATA_FRAME();                       // build frame w/ actual SEQ, ACK....
+  LastTrafficTime = TCPTimer;
+  RequestSend(TxFrame1Size);
+
+  if (Rdy4Tx())                                  // CS8900 ready to accept our frame?
+  {                                              // (see note above)
+    CopyToFrame8900(TCPSocket->Header, TCP_DATA_OFS);  // the socket's header template
+    if (TxFrame1ConstCount && (Count & 1))       // a word is split between RAM and
+    {                                            // the constant data?
+      CopyToFrame8900((unsigned char *)TxFrame1Mem, Count - 1);
+      WriteFrame8900(*((unsigned char *)TxFrame1Mem + Count - 1) |
+        (unsigned int)*TxFrame1Const << 8);
+      CopyToFrame8900(TxFrame1Const + 1, TxFrame1ConstCount - 1);
     }
     else
     {
-      TCPStateMachine = CLOSED;
-      SocketStatus = SOCK_ERR_ETHERNET;          // indicate an error to user
-      TCPFlags = 0;                              // clear all flags, stop timers etc.
+      CopyToFrame8900((unsigned char *)TxFrame1Mem, Count);
+      CopyToFrame8900(TxFrame1Const, TxFrame1ConstCount);
     }
-
-    TransmitControl &= ~SEND_FRAME2;             // clear tx-flag
+    TransmitControl &= ~SEND_FRAME1;             // clear tx-flag
   }
-
-  if (TransmitControl & SEND_FRAME1)
+  else
   {
-    PrepareTCP_DATA_FRAME();                     // build frame w/ actual SEQ, ACK....
-    RequestSend(TxFrame1Size);
-  
-    if (Rdy4Tx())                                // CS8900 ready to accept our frame?
-    {                                            // (see note above)
-      CopyToFrame8900((unsigned char *)TxFrame1Mem, TxFrame1Size);
-    }
-    else
-    {
-      TCPStateMachine = CLOSED;
-      SocketStatus = SOCK_ERR_ETHERNET;          // indicate an error to user
-      TCPFlags = 0;                              // clear all flags, stop timers etc.
-    }
-
+    TCPStateMachine = CLOSED;
+    SocketStatus = SOCK_ERR_ETHERNET;            // indicate an error to user
+    TCPFlags = 0;                                // clear all flags, stop timers etc.
     TransmitControl &= ~SEND_FRAME1;             // clear tx-flag
   }
+
+  TCPReleaseTxFrame1();                          // who may send the next segment?
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
@@ -328,6 +973,7 @@ void DoNetworkStuff(void)
 //------------------------------------------------------------------------------
 static void ProcessEthBroadcastFrame(void)
 {
+  unsigned int SenderMAC[3];
   unsigned int TargetIP[2];
 
   // next two words MUST be read with High-Byte 1st (CS8900 AN181 Page 2)
@@ -343,12 +989,15 @@ static void ProcessEthBroadcastFrame(void)
         if (ReadFrameBE8900() == IP_HLEN_PLEN)   // check HLEN, PLEN
           if (ReadFrameBE8900() == OP_ARP_REQUEST)
           {
-            DummyReadFrame8900(6);               // ignore sender's hardware address
+            CopyFromFrame8900(&SenderMAC, 6);    // read sender's hardware address
             CopyFromFrame8900(&RecdFrameIP, 4);  // read sender's protocol address
             DummyReadFrame8900(6);               // ignore target's hardware address
             CopyFromFrame8900(&TargetIP, 4);     // read target's protocol address
             if ((MyIP[0] == TargetIP[0]) && (MyIP[1] == TargetIP[1]))  // is it for us?
+            {
               PrepareARP_ANSWER();               // yes->create ARP_ANSWER frame
+              ARPCacheUpdate(RecdFrameIP, SenderMAC);  // sender will talk to us soon
+            }
           }
 }
 //------------------------------------------------------------------------------
@@ -360,6 +1009,8 @@ static void ProcessEthIAFrame(void)
 {
   unsigned int TargetIP[2];
   unsigned char ProtocolType;
+  unsigned long Sum;                             // IP header checksum
+  unsigned int Word;
 
   // next two words MUST be read with High-Byte 1st (CS8900 AN181 Page 2)
   ReadHB1ST8900(RX_FRAME_PORT);                  // ignore RxStatus Word
@@ -371,33 +1022,61 @@ static void ProcessEthIAFrame(void)
   switch (ReadFrameBE8900())                     // get frame type
   {
     case FRAME_ARP :                             // check for ARP
-      if ((TCPFlags & (TCP_ACTIVE_OPEN | IP_ADDR_RESOLVED)) == TCP_ACTIVE_OPEN)
-        if (ReadFrameBE8900() == HARDW_ETH10)         // check for the right prot. etc.
-          if (ReadFrameBE8900() == FRAME_IP)
-            if (ReadFrameBE8900() == IP_HLEN_PLEN)
-              if (ReadFrameBE8900() == OP_ARP_ANSWER)
-              {
-                TCPStopTimer();                       // OK, now we've the MAC we wanted ;-)
-                CopyFromFrame8900(&RemoteMAC, 6);     // extract opponents MAC
-                TCPFlags |= IP_ADDR_RESOLVED;
-              }
+      if (ReadFrameBE8900() == HARDW_ETH10)           // check for the right prot. etc.
+        if (ReadFrameBE8900() == FRAME_IP)
+          if (ReadFrameBE8900() == IP_HLEN_PLEN)
+            if (ReadFrameBE8900() == OP_ARP_ANSWER)
+            {
+              CopyFromFrame8900(&RecdFrameMAC, 6);    // read sender's hardware address
+              CopyFromFrame8900(&RecdFrameIP, 4);     // read sender's protocol address
+              ARPCacheUpdate(RecdFrameIP, RecdFrameMAC);
+
+              for (TCPSocket = TCPSockets; TCPSocket < TCPSockets + TCP_MAX_SOCKETS; TCPSocket++)
+                if ((TCPFlags & (TCP_ACTIVE_OPEN | IP_ADDR_RESOLVED)) == TCP_ACTIVE_OPEN)
+                  if ((NextHopIP(RemoteIP)[0] == RecdFrameIP[0]) &&
+                      (NextHopIP(RemoteIP)[1] == RecdFrameIP[1]))  // the MAC this socket wanted?
+                  {
+                    TCPStopTimer();                   // OK, now we've the MAC we wanted ;-)
+                    RemoteMAC[0] = RecdFrameMAC[0];   // take over opponents MAC
+                    RemoteMAC[1] = RecdFrameMAC[1];
+                    RemoteMAC[2] = RecdFrameMAC[2];
+                    TCPBuildHeader();
+                    TCPFlags |= IP_ADDR_RESOLVED;
+                  }
+            }
       break;
     case FRAME_IP :                                        // check for IP-type
-      if ((ReadFrameBE8900() & 0xff00 ) == IP_VER_IHL)     // IPv4, IHL=5 (20 Bytes Header)
+      Sum = ReadFrameBE8900();
+      if ((Sum & 0xff00) == IP_VER_IHL)                    // IPv4, IHL=5 (20 Bytes Header)
       {                                                    // ignore Type Of Service
         RecdIPFrameLength = ReadFrameBE8900();             // get IP frame's length
-        ReadFrameBE8900();                                 // ignore identification
+        Sum += RecdIPFrameLength;
+        Sum += ReadFrameBE8900();                          // ignore identification
+        Word = ReadFrameBE8900();
+        Sum += Word;
 
-        if (!(ReadFrameBE8900() & (IP_FLAG_MOREFRAG | IP_FRAGOFS_MASK)))  // only unfragm. frames
+        if (!(Word & (IP_FLAG_MOREFRAG | IP_FRAGOFS_MASK)))  // only unfragm. frames
         {
-          ProtocolType = ReadFrameBE8900();                // get protocol, ignore TTL
-          ReadFrameBE8900();                               // ignore checksum
+          Word = ReadFrameBE8900();                        // get protocol, ignore TTL
+          ProtocolType = Word;
+          Sum += Word;
+          Sum += ReadFrameBE8900();                        // checksum (verified below)
           RecdFrameIP[0] = ReadFrame8900();                // get source IP
           RecdFrameIP[1] = ReadFrame8900();
           TargetIP[0] = ReadFrame8900();                   // get destination IP
           TargetIP[1] = ReadFrame8900();
+          Sum += __swap_bytes(RecdFrameIP[0]);             // (read in memory byte order)
+          Sum += __swap_bytes(RecdFrameIP[1]);
+          Sum += __swap_bytes(TargetIP[0]);
+          Sum += __swap_bytes(TargetIP[1]);
+
+          if ((MyIP[0] == TargetIP[0]) && (MyIP[1] == TargetIP[1]) &&  // is it for us,
+              (ChecksumFold(Sum) == 0xffff))                           // header intact?
+          {
+            if (!((RecdFrameIP[0] ^ MyIP[0]) & SubnetMask[0]) &&
+                !((RecdFrameIP[1] ^ MyIP[1]) & SubnetMask[1]))  // local sender? (else it's
+              ARPCacheUpdate(RecdFrameIP, RecdFrameMAC);        // the gateway's MAC)
 
-          if ((MyIP[0] == TargetIP[0]) && (MyIP[1] == TargetIP[1]))  // is it for us?
             switch (ProtocolType)
             {
               case PROT_ICMP :
@@ -406,9 +1085,11 @@ static void ProcessEthIAFrame(void)
               case PROT_TCP :
                 ProcessTCPFrame();
                 break;
-              case PROT_UDP :                              // not implemented!
+              case PROT_UDP :
+                ProcessUDPFrame();
                 break;
             }
+          }
         }      
       break;
     }
@@ -422,14 +1103,16 @@ static void ProcessEthIAFrame(void)
 static void ProcessICMPFrame(void)
 {
   unsigned int ICMPTypeAndCode;
+  unsigned long Sum;
 
   ICMPTypeAndCode = ReadFrameBE8900();           // get Message Type and Code
-  ReadFrameBE8900();                             // ignore ICMP checksum
+  Sum = ICMPTypeAndCode;
+  Sum += ReadFrameBE8900();                      // get ICMP checksum (verified with the data)
 
   switch (ICMPTypeAndCode >> 8)                  // check type
   {
     case ICMP_ECHO :                             // is echo request?
-      PrepareICMP_ECHO_REPLY();                  // echo as much as we can...
+      PrepareICMP_ECHO_REPLY(__swap_bytes(ChecksumFold(Sum)));  // echo as much as we can...
       break;
   }
 }
@@ -445,14 +1128,17 @@ static void ProcessTCPFrame(void)
   unsigned long TCPSegSeq;                       // segment's sequence number
   unsigned long TCPSegAck;                       // segment's acknowledge number
   unsigned int TCPCode;                          // TCP code and header length
+  unsigned int TCPSegWindow;                     // segment's window
   unsigned char TCPHeaderSize;                   // real TCP header length
   unsigned int NrOfDataBytes;                    // real number of data
+  unsigned long Sum;                             // sum of the header (network byte order)
+  unsigned int Checksum;                         // sum of the segment (memory byte order)
+  unsigned int DataOfs;                          // record of the data in the receive ring
+  unsigned char Streamed;                        // data passed to the receive handler
     
   TCPSegSourcePort = ReadFrameBE8900();                    // get ports
   TCPSegDestPort = ReadFrameBE8900();
 
-  if (TCPSegDestPort != TCPLocalPort) return;              // drop segment if port doesn't match
-
   TCPSegSeq = (unsigned long)ReadFrameBE8900() << 16;      // get segment sequence nr.
   TCPSegSeq |= ReadFrameBE8900();
 
@@ -460,14 +1146,56 @@ static void ProcessTCPFrame(void)
   TCPSegAck |= ReadFrameBE8900();
 
   TCPCode = ReadFrameBE8900();                             // get control bits, header length...
+  TCPSegWindow = ReadFrameBE8900();                        // get window
+
+  Sum = (unsigned long)TCPSegSourcePort + TCPSegDestPort +
+    (TCPSegSeq >> 16) + (TCPSegSeq & 0xffff) + (TCPSegAck >> 16) + (TCPSegAck & 0xffff) +
+    TCPCode + TCPSegWindow;
+  Sum += ReadFrameBE8900();                                // checksum (verified below)
+  Sum += ReadFrameBE8900();                                // ignore urgent pointer
 
   TCPHeaderSize = (TCPCode & DATA_OFS_MASK) >> 10;         // header length in bytes
   NrOfDataBytes = RecdIPFrameLength - IP_HEADER_SIZE - TCPHeaderSize;     // seg. text length
 
   if (NrOfDataBytes > MAX_TCP_RX_DATA_SIZE) return;        // drop, packet too large for us :'(
 
+  Checksum = PseudoSum(RecdFrameIP, PROT_TCP, RecdIPFrameLength - IP_HEADER_SIZE,
+    __swap_bytes(ChecksumFold(Sum)));
+
   if (TCPHeaderSize > TCP_HEADER_SIZE)                     // ignore options if any
-    DummyReadFrame8900(TCPHeaderSize - TCP_HEADER_SIZE);
+    Checksum = DummyReadFrameSum8900(TCPHeaderSize - TCP_HEADER_SIZE, Checksum);
+
+  if (!TCPDemultiplex(TCPSegSourcePort, TCPSegDestPort, TCPCode))
+    return;                                                // drop, nobody serves this port
+
+  DataOfs = RX_RING_NO_ROOM;
+  Streamed = 0;
+  if (NrOfDataBytes && TCPRxHandler)                       // the user's handler reads the
+  {                                                        // data while it is summed up,
+    if (TCPRxAcceptable(TCPSegSeq, TCPSegAck, TCPCode))    // if the state machine will
+    {                                                      // accept it below
+      Checksum = TCPStreamRx(NrOfDataBytes, Checksum);
+      Streamed = 1;
+    }
+    else
+      Checksum = DummyReadFrameSum8900(NrOfDataBytes, Checksum);
+  }
+  else if (NrOfDataBytes)                                  // copy the data into the receive
+  {                                                        // ring while summing it up, the
+    DataOfs = RxRingReserve(NrOfDataBytes);                // state machine decides below
+    if (DataOfs != RX_RING_NO_ROOM)                        // whether to keep it
+      Checksum = CopyFromFrameSum8900((unsigned char *)RxTCPBufferMem + DataOfs + 2,
+        NrOfDataBytes, Checksum);
+    else
+      Checksum = DummyReadFrameSum8900(NrOfDataBytes, Checksum);
+  }
+
+  if (Checksum != 0xffff)                                  // drop, segment corrupted
+  {
+    if (Streamed)                                          // the handler has to forget
+      TCPRxHandler(TCPSocket - TCPSockets, TCP_RX_CORRUPTED);  // what it has read
+    return;
+  }
 
   switch (TCPStateMachine)                                 // implement the TCP state machine
   {                                                        // RFC793
@@ -481,6 +1209,7 @@ static void ProcessTCPFrame(void)
         RemoteMAC[2] = RecdFrameMAC[2];
         RemoteIP[0] = RecdFrameIP[0];
         RemoteIP[1] = RecdFrameIP[1];
+        TCPBuildHeader();
         
         if (TCPCode & TCP_CODE_ACK)                        // make the reset sequence
         {                                                  // acceptable to the other
@@ -504,6 +1233,7 @@ static void ProcessTCPFrame(void)
         RemoteMAC[2] = RecdFrameMAC[2];
         RemoteIP[0] = RecdFrameIP[0];
         RemoteIP[1] = RecdFrameIP[1];
+        TCPBuildHeader();
 
         if (TCPCode & TCP_CODE_ACK)                        // reset a bad
         {                                                  // acknowledgement
@@ -515,22 +1245,17 @@ static void ProcessTCPFrame(void)
           TCPAckNr = TCPSegSeq + 1;                           // get remote ISN, next byte we expect
           TCPSeqNr = ((unsigned long)ISNGenHigh << 16) | TAR; // set local ISN
           TCPUNASeqNr = TCPSeqNr + 1;                         // one byte out -> increase by one
+          TCPResetTx();
+          TCPSndWnd = TCPSegWindow;
           PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_SYN | TCP_CODE_ACK); // acknowledge connection request
           LastFrameSent = TCP_SYN_ACK_FRAME;
+          TCPStartRTTMeasurement();
           TCPStartRetryTimer();
           TCPStateMachine = SYN_RECD;
         }
       }
       break;
     case SYN_SENT :
-      // drop segment if its IP doesn't belong to current session
-      if ((RemoteIP[0] != RecdFrameIP[0]) || (RemoteIP[1] != RecdFrameIP[1]))
-        break;      
-
-      // drop segment if port doesn't match
-      if (TCPSegSourcePort != TCPRemotePort)
-        break;   
-      
       if (TCPCode & TCP_CODE_ACK)                // ACK field significant?
         if (TCPSegAck != TCPUNASeqNr)            // is our ISN ACKed?
         {
@@ -560,12 +1285,15 @@ static void ProcessTCPFrame(void)
         if (TCPCode & TCP_CODE_ACK)
         {
           TCPStopTimer();                        // stop retransmission, other TCP got our SYN
+          TCPUpdateRTO(TCPSegAck);
           TCPSeqNr = TCPUNASeqNr;                // advance our sequence number
+          TCPSndWnd = TCPSegWindow;
 
           PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_ACK);        // ACK this ISN
           TCPStateMachine = ESTABLISHED;
+          TCPSocket->IdleStart = TCPTimer;       // start idle timeout
           SocketStatus |= SOCK_CONNECTED;
-          SocketStatus |= SOCK_TX_BUF_RELEASED;  // user may send data now :-)
+          TCPCheckTxWindow();                    // user may send data now :-)
         }
         else
         {
@@ -578,17 +1306,14 @@ static void ProcessTCPFrame(void)
       }
       break;
     default :
-      // drop segment if IP doesn't belong to current session
-      if ((RemoteIP[0] != RecdFrameIP[0]) || (RemoteIP[1] != RecdFrameIP[1]))
-        break;      
-
-      // drop segment if port doesn't match        
-      if (TCPSegSourcePort != TCPRemotePort)
-        break;     
-
       // drop segment if it doesn't fall into the receive window
-      if ((TCPSegSeq < TCPAckNr) || (TCPSegSeq >= TCPAckNr + MAX_TCP_RX_DATA_SIZE))
+      if ((unsigned long)(TCPSegSeq - TCPAckNr) >=
+          (TCPRxHandler ? TCP_RX_STREAM_WINDOW : TCP_RX_BUF_SIZE))
+      {
+        if (!(TCPCode & TCP_CODE_RST))           // e.g. a retransmission: our ACK got
+          PrepareTCP_FRAME(TCPUNASeqNr, TCPAckNr, TCP_CODE_ACK);  // lost, send it again
         break;
+      }
             
       if (TCPCode & TCP_CODE_RST)                // RST??
       {
@@ -615,19 +1340,52 @@ static void ProcessTCPFrame(void)
 
       if (!(TCPCode & TCP_CODE_ACK)) break;      // drop segment if the ACK bit is off
 
+      if ((TCPSegAck == TCPSeqNr) && TxSegCount && !NrOfDataBytes &&
+          !(TCPCode & TCP_CODE_FIN) && (TCPSegWindow == TCPSndWnd))
+      {                                          // duplicate ACK, a segment got lost?
+        if (TCPSocket->DupAcks < TCP_DUP_ACK_THRESHOLD)
+          if (++TCPSocket->DupAcks == TCP_DUP_ACK_THRESHOLD)
+          {
+            TCPRewindTx();                       // fast retransmission (RFC 5681), further
+            TCPRestartTimer();                   // dup. ACKs are ignored until new data
+          }                                      // is ACKed
+      }
+
+      // acceptable ACK (SND.UNA <= SEG.ACK <= SND.NXT)? take over the window
+      if ((unsigned long)(TCPSegAck - TCPSeqNr) <= (unsigned long)(TCPUNASeqNr - TCPSeqNr))
+        TCPSndWnd = TCPSegWindow;
+
+      if (TxSegCount && (TCPSegAck != TCPSeqNr) && (TCPSegAck != TCPUNASeqNr) &&
+          ((unsigned long)(TCPSegAck - TCPSeqNr) < (unsigned long)(TCPUNASeqNr - TCPSeqNr)))
+      {                                          // some (not all) of our data ACKed?
+        TCPUpdateRTO(TCPSegAck);
+        TCPAckTxSegments(TCPSegAck);             // advance to the oldest unacked byte,
+        TCPStartRetryTimer();                    // time the rest
+        TCPCheckTxWindow();                      // and let the user send more
+      }
+
       if (TCPSegAck == TCPUNASeqNr)              // is our last data sent ACKed?
       {
         TCPStopTimer();                          // stop retransmission
+        if (TCPSegAck != TCPSeqNr)
+        {
+          TCPUpdateRTO(TCPSegAck);
+          TCPSocket->DupAcks = 0;
+          TCPSocket->IdleStart = TCPTimer;       // (re)start idle timeout
+        }
         TCPSeqNr = TCPUNASeqNr;                  // advance our sequence number
+        TxSegCount = 0;                          // nothing in flight anymore
 
         switch (TCPStateMachine)                 // change state if necessary
         {
           case SYN_RECD :                        // ACK of our SYN?
             TCPStateMachine = ESTABLISHED;       // user may send data now :-)
             SocketStatus |= SOCK_CONNECTED;
+            TCPCheckTxWindow();                  // (the ACK may come with the request)
             break;
           case ESTABLISHED :
-            SocketStatus |= SOCK_TX_BUF_RELEASED;  // give TX buffer back
+          case CLOSE_WAIT :
+            TCPCheckTxWindow();                  // give TX buffer back
             break;
           case FIN_WAIT_1 :                      // ACK of our FIN?
             TCPStateMachine = FIN_WAIT_2;
@@ -664,19 +1422,23 @@ static void ProcessTCPFrame(void)
       {
         if (NrOfDataBytes)                                 // data available?
         {
-          if (!(SocketStatus & SOCK_DATA_AVAILABLE))       // rx data-buffer empty?
+          TCPSocket->IdleStart = TCPTimer;                 // connection isn't idle
+          if (Streamed)                                    // the user's handler has got it
+          {
+            TCPAckNr += NrOfDataBytes;
+            TCPDelayAck();
+          }
+          else if (DataOfs != RX_RING_NO_ROOM)             // keep data, tell the user
           {
-            DummyReadFrame8900(6);                         // ignore window, checksum, urgent pointer
-            CopyFromFrame8900(RxTCPBufferMem, NrOfDataBytes);  // fetch data and
-            TCPRxDataCount = NrOfDataBytes;                // ...tell the user...
-            SocketStatus |= SOCK_DATA_AVAILABLE;           // indicate the new data to user
+            RxRingPut(DataOfs, NrOfDataBytes);
             TCPAckNr += NrOfDataBytes;
-            PrepareTCP_FRAME(TCPSegAck, TCPAckNr, TCP_CODE_ACK);  // ACK rec'd data
+            TCPDelayAck();                                 // ACK rec'd data (now or later)
           }
           else
-            break;                               // stop processing here, we cannot send an
-                                                 // acknowledge packet as the received data
-                                                 // could not be passed to the app layer
+          {                                      // no room in the receive ring, drop it
+            PrepareTCP_FRAME(TCPUNASeqNr, TCPAckNr, TCP_CODE_ACK);  // and tell the other
+            break;                               // TCP our real window
+          }
         }
       }
       if (TCPCode & TCP_CODE_FIN)                // FIN??
@@ -708,46 +1470,63 @@ static void ProcessTCPFrame(void)
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
-// prepares the TxFrame2-buffer to send an ARP-request
+// we've just rec'd an UDP-frame (User Datagram Protocol): the datagram is
+// passed to the receive handler of the socket bound to its destination
+// port, the checksum (if any) is verified afterwards
 //------------------------------------------------------------------------------
-static void PrepareARP_REQUEST(void)
+static void ProcessUDPFrame(void)
 {
-  // Ethernet
+  TUDPSocket *Socket;
+  unsigned int SourcePort;
+  unsigned int DestPort;
+  unsigned int Length;                           // header plus data
+  unsigned int Checksum;
+  unsigned long Sum;
+
+  if (RecdIPFrameLength < IP_HEADER_SIZE + UDP_HEADER_SIZE)
+    return;                                      // drop, no room for the UDP header
+
+  SourcePort = ReadFrameBE8900();
+  DestPort = ReadFrameBE8900();
+  Length = ReadFrameBE8900();
+  Checksum = ReadFrameBE8900();                  // (0 = not computed by the sender)
+
+  if ((Length < UDP_HEADER_SIZE) || (Length > RecdIPFrameLength - IP_HEADER_SIZE))
+    return;                                      // drop, length is wrong
+
+  for (Socket = UDPSockets; Socket < UDPSockets + UDP_MAX_SOCKETS; Socket++)
+    if (Socket->LocalPort && (Socket->LocalPort == DestPort))
+      break;
+
+  if ((Socket == UDPSockets + UDP_MAX_SOCKETS) || !Socket->RxHandler)
+    return;                                      // drop, nobody serves this port
+
+  Sum = (unsigned long)SourcePort + DestPort + Length + Checksum;
+  RxStreamBegin(Length - UDP_HEADER_SIZE, PseudoSum(RecdFrameIP, PROT_UDP, Length,
+    __swap_bytes(ChecksumFold(Sum))));
+  Socket->RxHandler(Socket - UDPSockets, RecdFrameIP, SourcePort, Length - UDP_HEADER_SIZE);
+
+  if ((RxStreamEnd() != 0xffff) && Checksum)     // corrupted? the handler has to forget it
+    Socket->RxHandler(Socket - UDPSockets, RecdFrameIP, SourcePort, UDP_RX_CORRUPTED);
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// prepares the TxFrame2-buffer to send an ARP-request for 'TargetIP' on
+// behalf of the selected socket
+//------------------------------------------------------------------------------
+static void PrepareARP_REQUEST(const unsigned int *TargetIP)
+{
+  if (TransmitControl & SEND_FRAME2)             // TxFrame2 still occupied by another
+    SendFrame2();                                // frame? send that one first
+  TxFrame2Socket = TCPSocket;
+
+  CopyTemplate(ARPFrameTemplate, ETH_HEADER_SIZE + ARP_FRAME_SIZE);
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS) = 0xffff;  // we don't know opposites MAC!
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 2) = 0xffff;
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 4) = 0xffff;
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_TYPE_OFS) = SWAPB(FRAME_ARP);
-
-  // ARP
-  ACCESS_UINT(TxFrame2Mem, ARP_HARDW_OFS) = SWAPB(HARDW_ETH10);
-  ACCESS_UINT(TxFrame2Mem, ARP_PROT_OFS) = SWAPB(FRAME_IP); 
-  ACCESS_UINT(TxFrame2Mem, ARP_HLEN_PLEN_OFS) = SWAPB(IP_HLEN_PLEN);
   ACCESS_UINT(TxFrame2Mem, ARP_OPCODE_OFS) = SWAPB(OP_ARP_REQUEST);
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_HA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_HA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_HA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_IP_OFS) = MyIP[0];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_IP_OFS + 2) = MyIP[1];
-  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_HA_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_HA_OFS + 2) = 0;
-  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_HA_OFS + 4) = 0;
-  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS + 2) = 0;
-
-  if (((RemoteIP[0] ^ MyIP[0]) & SubnetMask[0]) ||
-      ((RemoteIP[1] ^ MyIP[1]) & SubnetMask[1]))
-  {
-    ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS) = GatewayIP[0];
-    ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS + 2) = GatewayIP[1];
-  }
-  else
-  {
-    ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS) = RemoteIP[0];
-    ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS + 2) = RemoteIP[1];
-  }
+  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS) = TargetIP[0];
+  ACCESS_UINT(TxFrame2Mem, ARP_TARGET_IP_OFS + 2) = TargetIP[1];
 
   TxFrame2Size = ETH_HEADER_SIZE + ARP_FRAME_SIZE;
   TransmitControl |= SEND_FRAME2;
@@ -758,25 +1537,15 @@ static void PrepareARP_REQUEST(void)
 //------------------------------------------------------------------------------
 static void PrepareARP_ANSWER(void)
 {
-  // Ethernet
+  if (TransmitControl & SEND_FRAME2)             // TxFrame2 still occupied by another
+    SendFrame2();                                // frame? send that one first
+  TxFrame2Socket = 0;
+
+  CopyTemplate(ARPFrameTemplate, ETH_HEADER_SIZE + ARP_FRAME_SIZE);
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS) = RecdFrameMAC[0];
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 2) = RecdFrameMAC[1];
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 4) = RecdFrameMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_TYPE_OFS) = SWAPB(FRAME_ARP);
-
-  // ARP
-  ACCESS_UINT(TxFrame2Mem, ARP_HARDW_OFS) = SWAPB(HARDW_ETH10);
-  ACCESS_UINT(TxFrame2Mem, ARP_PROT_OFS) = SWAPB(FRAME_IP); 
-  ACCESS_UINT(TxFrame2Mem, ARP_HLEN_PLEN_OFS) = SWAPB(IP_HLEN_PLEN);
   ACCESS_UINT(TxFrame2Mem, ARP_OPCODE_OFS) = SWAPB(OP_ARP_ANSWER);
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_HA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_HA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_HA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_IP_OFS) = MyIP[0];
-  ACCESS_UINT(TxFrame2Mem, ARP_SENDER_IP_OFS + 2) = MyIP[1];
   ACCESS_UINT(TxFrame2Mem, ARP_TARGET_HA_OFS) = RecdFrameMAC[0];
   ACCESS_UINT(TxFrame2Mem, ARP_TARGET_HA_OFS + 2) = RecdFrameMAC[1];
   ACCESS_UINT(TxFrame2Mem, ARP_TARGET_HA_OFS + 4) = RecdFrameMAC[2];
@@ -788,48 +1557,44 @@ static void PrepareARP_ANSWER(void)
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
-// prepares the TxFrame2-buffer to send an ICMP-echo-reply
+// prepares the TxFrame2-buffer to send an ICMP-echo-reply. 'HeaderSum' is
+// the sum of the request's type, code and checksum, the request is only
+// answered if its checksum is right.
 //------------------------------------------------------------------------------
-static void PrepareICMP_ECHO_REPLY(void)
+static void PrepareICMP_ECHO_REPLY(unsigned int HeaderSum)
 {
   unsigned int ICMPDataCount;
+  unsigned int DataSum;                          // one's complement sum of the echoed data
 
   if (RecdIPFrameLength > MAX_ETH_TX_DATA_SIZE)  // don't overload TX-buffer
     ICMPDataCount = MAX_ETH_TX_DATA_SIZE - IP_HEADER_SIZE - ICMP_HEADER_SIZE;
   else
     ICMPDataCount = RecdIPFrameLength - IP_HEADER_SIZE - ICMP_HEADER_SIZE;
 
-  // Ethernet
+  if (TransmitControl & SEND_FRAME2)             // TxFrame2 still occupied by another
+    SendFrame2();                                // frame? send that one first
+  TxFrame2Socket = 0;
+
+  CopyTemplate(ICMPReplyTemplate, ICMP_DATA_OFS);
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS) = RecdFrameMAC[0];
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 2) = RecdFrameMAC[1];
   ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 4) = RecdFrameMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_TYPE_OFS) = SWAPB(FRAME_IP);
-  
-  // IP   
-  ACCESS_UINT(TxFrame2Mem, IP_VER_IHL_TOS_OFS) = SWAPB(IP_VER_IHL);
   ACCESS_UINT(TxFrame2Mem, IP_TOTAL_LENGTH_OFS) =
     __swap_bytes(IP_HEADER_SIZE + ICMP_HEADER_SIZE + ICMPDataCount);
-  ACCESS_UINT(TxFrame2Mem, IP_IDENT_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, IP_FLAGS_FRAG_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, IP_TTL_PROT_OFS) = SWAPB((DEFAULT_TTL << 8) | PROT_ICMP);
-  ACCESS_UINT(TxFrame2Mem, IP_HEAD_CHKSUM_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, IP_SOURCE_OFS) = MyIP[0];
-  ACCESS_UINT(TxFrame2Mem, IP_SOURCE_OFS + 2) = MyIP[1];
   ACCESS_UINT(TxFrame2Mem, IP_DESTINATION_OFS) = RecdFrameIP[0];
   ACCESS_UINT(TxFrame2Mem, IP_DESTINATION_OFS + 2) = RecdFrameIP[1];
-  ACCESS_UINT(TxFrame2Mem, IP_HEAD_CHKSUM_OFS) = 
-    CalcChecksum((unsigned char *)TxFrame2Mem + IP_VER_IHL_TOS_OFS, IP_HEADER_SIZE, 0);
+  ACCESS_UINT(TxFrame2Mem, IP_HEAD_CHKSUM_OFS) = ~ChecksumFold(ICMP_REPLY_IP_SUM +
+    ACCESS_UINT(TxFrame2Mem, IP_TOTAL_LENGTH_OFS) + RecdFrameIP[0] + RecdFrameIP[1]);
+
+  DataSum = CopyFromFrameSum8900((unsigned char *)TxFrame2Mem + ICMP_DATA_OFS,
+    ICMPDataCount, 0);                                          // get data to echo...
 
-  // ICMP
-  ACCESS_UINT(TxFrame2Mem, ICMP_TYPE_CODE_OFS) = SWAPB(ICMP_ECHO_REPLY << 8);
-  ACCESS_UINT(TxFrame2Mem, ICMP_CHKSUM_OFS) = 0;                // initialize checksum field
-  CopyFromFrame8900((unsigned char *)TxFrame2Mem + ICMP_DATA_OFS, ICMPDataCount);  // get data to echo...
-  ACCESS_UINT(TxFrame2Mem, ICMP_CHKSUM_OFS) = 
-    CalcChecksum((unsigned char *)TxFrame2Mem + IP_DATA_OFS, ICMPDataCount +
-      ICMP_HEADER_SIZE, 0);
+  if (DummyReadFrameSum8900(RecdIPFrameLength - IP_HEADER_SIZE - ICMP_HEADER_SIZE -
+        ICMPDataCount, ChecksumFold((unsigned long)DataSum + HeaderSum)) != 0xffff)
+    return;                                                     // drop, request corrupted
+
+  ACCESS_UINT(TxFrame2Mem, ICMP_CHKSUM_OFS) =
+    ~ChecksumFold((unsigned long)DataSum + SWAPB(ICMP_ECHO_REPLY << 8));
 
   TxFrame2Size = ETH_HEADER_SIZE + IP_HEADER_SIZE + ICMP_HEADER_SIZE + ICMPDataCount;
   TransmitControl |= SEND_FRAME2;
@@ -842,65 +1607,36 @@ static void PrepareICMP_ECHO_REPLY(void)
 static void PrepareTCP_FRAME(unsigned long seqnr, unsigned long acknr,
   unsigned int TCPCode)
 {
-  // Ethernet
-  ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS) = RemoteMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 2) = RemoteMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ETH_DA_OFS + 4) = RemoteMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame2Mem, ETH_SA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame2Mem, ETH_TYPE_OFS) = SWAPB(FRAME_IP);
-  
-  // IP
-  ACCESS_UINT(TxFrame2Mem, IP_VER_IHL_TOS_OFS) = SWAPB(IP_VER_IHL);
+  unsigned int Window;
 
-  if (TCPCode & TCP_CODE_SYN)                    // if SYN, we want to use the MSS option
-    ACCESS_UINT(TxFrame2Mem, IP_TOTAL_LENGTH_OFS) =
-      SWAPB(IP_HEADER_SIZE + TCP_HEADER_SIZE + TCP_OPT_MSS_SIZE);
-  else
-    ACCESS_UINT(TxFrame2Mem, IP_TOTAL_LENGTH_OFS) =
-      SWAPB(IP_HEADER_SIZE + TCP_HEADER_SIZE);
-
-  ACCESS_UINT(TxFrame2Mem, IP_IDENT_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, IP_FLAGS_FRAG_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, IP_TTL_PROT_OFS) = SWAPB((DEFAULT_TTL << 8) | PROT_TCP);
-  ACCESS_UINT(TxFrame2Mem, IP_HEAD_CHKSUM_OFS) = 0;
-  ACCESS_UINT(TxFrame2Mem, IP_SOURCE_OFS) = MyIP[0];
-  ACCESS_UINT(TxFrame2Mem, IP_SOURCE_OFS + 2) = MyIP[1];
-  ACCESS_UINT(TxFrame2Mem, IP_DESTINATION_OFS) = RemoteIP[0];
-  ACCESS_UINT(TxFrame2Mem, IP_DESTINATION_OFS + 2) = RemoteIP[1];
-  ACCESS_UINT(TxFrame2Mem, IP_HEAD_CHKSUM_OFS) = 
-    CalcChecksum((unsigned char *)TxFrame2Mem + IP_VER_IHL_TOS_OFS,
-      IP_HEADER_SIZE, 0);
-  
-  // TCP
-  ACCESS_UINT(TxFrame2Mem, TCP_SRCPORT_OFS) = __swap_bytes(TCPLocalPort);
-  ACCESS_UINT(TxFrame2Mem, TCP_DESTPORT_OFS) = __swap_bytes(TCPRemotePort);
+  if (TransmitControl & SEND_FRAME2)             // TxFrame2 still occupied by another
+    SendFrame2();                                // frame? send that one first
+  TxFrame2Socket = TCPSocket;
 
-  WriteDWBE((unsigned char *)TxFrame2Mem + TCP_SEQNR_OFS, seqnr);
-  WriteDWBE((unsigned char *)TxFrame2Mem + TCP_ACKNR_OFS, acknr);
+  Window = TCPRxWindow();
 
-  ACCESS_UINT(TxFrame2Mem, TCP_WINDOW_OFS) = SWAPB(MAX_TCP_RX_DATA_SIZE);    // data bytes to accept
-  ACCESS_UINT(TxFrame2Mem, TCP_CHKSUM_OFS) = 0;  // initalize checksum
-  ACCESS_UINT(TxFrame2Mem, TCP_URGENT_OFS) = 0;
+  if ((TCPCode & TCP_CODE_ACK) && (acknr == TCPAckNr))
+  {
+    TCPFlags &= ~TCP_ACK_PENDING;                // this frame ACKs all rec'd data
+    TCPSocket->RcvEdge = (unsigned int)acknr + Window;
+  }
+
+  CopyTemplate(TCPSocket->Header, TCP_DATA_OFS);
 
   if (TCPCode & TCP_CODE_SYN)                    // if SYN, we want to use the MSS option
   {
-    ACCESS_UINT(TxFrame2Mem, TCP_DATA_CODE_OFS) = SWAPB(0x6000 | TCPCode);   // TCP header length = 24
     ACCESS_UINT(TxFrame2Mem, TCP_DATA_OFS) = SWAPB(TCP_OPT_MSS);             // MSS option
     ACCESS_UINT(TxFrame2Mem, TCP_DATA_OFS + 2) = SWAPB(MAX_TCP_RX_DATA_SIZE);// max. length of TCP-data we accept
-    ACCESS_UINT(TxFrame2Mem, TCP_CHKSUM_OFS) =
-      CalcChecksum((unsigned char *)TxFrame2Mem + TCP_SRCPORT_OFS,
-        TCP_HEADER_SIZE + TCP_OPT_MSS_SIZE, 1);
+    TCPCompleteHeader(TxFrame2Mem, seqnr, acknr, 0x6000 | TCPCode, Window,   // TCP header length = 24
+      TCP_HEADER_SIZE + TCP_OPT_MSS_SIZE,
+      ChecksumFold((unsigned long)SWAPB(TCP_OPT_MSS) + SWAPB(MAX_TCP_RX_DATA_SIZE)));
     TxFrame2Size = ETH_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE +
       TCP_OPT_MSS_SIZE;
   }
   else
   {
-    ACCESS_UINT(TxFrame2Mem, TCP_DATA_CODE_OFS) = SWAPB(0x5000 | TCPCode);   // TCP header length = 20
-    ACCESS_UINT(TxFrame2Mem, TCP_CHKSUM_OFS) =
-      CalcChecksum((unsigned char *)TxFrame2Mem + TCP_SRCPORT_OFS,
-        TCP_HEADER_SIZE, 1);
+    TCPCompleteHeader(TxFrame2Mem, seqnr, acknr, 0x5000 | TCPCode, Window,   // TCP header length = 20
+      TCP_HEADER_SIZE, 0);
     TxFrame2Size = ETH_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE;
   }
 
@@ -908,85 +1644,220 @@ static void PrepareTCP_FRAME(unsigned long seqnr, unsigned long acknr,
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
-// prepares the TxFrame1-buffer to send a payload-packet
+// completes the socket's header template for the payload-packet in TxFrame1
 //------------------------------------------------------------------------------
 static void PrepareTCP_DATA_FRAME(void)
 {
-  // Ethernet
-  ACCESS_UINT(TxFrame1Mem, ETH_DA_OFS) = RemoteMAC[0];
-  ACCESS_UINT(TxFrame1Mem, ETH_DA_OFS + 2) = RemoteMAC[1];
-  ACCESS_UINT(TxFrame1Mem, ETH_DA_OFS + 4) = RemoteMAC[2];
-  ACCESS_UINT(TxFrame1Mem, ETH_SA_OFS) = MyMAC[0];
-  ACCESS_UINT(TxFrame1Mem, ETH_SA_OFS + 2) = MyMAC[1];
-  ACCESS_UINT(TxFrame1Mem, ETH_SA_OFS + 4) = MyMAC[2];
-  ACCESS_UINT(TxFrame1Mem, ETH_TYPE_OFS) = SWAPB(FRAME_IP);
-  
-  // IP   
-  ACCESS_UINT(TxFrame1Mem, IP_VER_IHL_TOS_OFS) = SWAPB(IP_VER_IHL);
-  ACCESS_UINT(TxFrame1Mem, IP_TOTAL_LENGTH_OFS) =
-    __swap_bytes(IP_HEADER_SIZE + TCP_HEADER_SIZE + TCPTxDataCount);
-  ACCESS_UINT(TxFrame1Mem, IP_IDENT_OFS) = 0;
-  ACCESS_UINT(TxFrame1Mem, IP_FLAGS_FRAG_OFS) = 0;
-  ACCESS_UINT(TxFrame1Mem, IP_TTL_PROT_OFS) = SWAPB((DEFAULT_TTL << 8) | PROT_TCP);
-  ACCESS_UINT(TxFrame1Mem, IP_HEAD_CHKSUM_OFS) = 0;
-  ACCESS_UINT(TxFrame1Mem, IP_SOURCE_OFS) = MyIP[0];
-  ACCESS_UINT(TxFrame1Mem, IP_SOURCE_OFS + 2) = MyIP[1];
-  ACCESS_UINT(TxFrame1Mem, IP_DESTINATION_OFS) = RemoteIP[0];
-  ACCESS_UINT(TxFrame1Mem, IP_DESTINATION_OFS + 2) = RemoteIP[1];
-  ACCESS_UINT(TxFrame1Mem, IP_HEAD_CHKSUM_OFS) = 
-    CalcChecksum((unsigned char *)TxFrame1Mem + IP_VER_IHL_TOS_OFS,
-      IP_HEADER_SIZE, 0);
+  unsigned int Window;
 
-  // TCP
-  ACCESS_UINT(TxFrame1Mem, TCP_SRCPORT_OFS) = __swap_bytes(TCPLocalPort);
-  ACCESS_UINT(TxFrame1Mem, TCP_DESTPORT_OFS) = __swap_bytes(TCPRemotePort);
+  TCPFlags &= ~TCP_ACK_PENDING;                  // piggyback a delayed ACK
+  Window = TCPRxWindow();
+  TCPSocket->RcvEdge = (unsigned int)TCPAckNr + Window;
 
-  WriteDWBE((unsigned char *)TxFrame1Mem + TCP_SEQNR_OFS, TCPSeqNr);
-  WriteDWBE((unsigned char *)TxFrame1Mem + TCP_ACKNR_OFS, TCPAckNr);
-  
-  ACCESS_UINT(TxFrame1Mem, TCP_DATA_CODE_OFS) = SWAPB(0x5000 | TCP_CODE_ACK);  // TCP header length = 20
-  ACCESS_UINT(TxFrame1Mem, TCP_WINDOW_OFS) = SWAPB(MAX_TCP_RX_DATA_SIZE);  // data bytes to accept
-  ACCESS_UINT(TxFrame1Mem, TCP_CHKSUM_OFS) = 0;  // initalize checksum
-  ACCESS_UINT(TxFrame1Mem, TCP_URGENT_OFS) = 0;
-  ACCESS_UINT(TxFrame1Mem, TCP_CHKSUM_OFS) =
-    CalcChecksum((unsigned char *)TxFrame1Mem + TCP_SRCPORT_OFS,
-      TCP_HEADER_SIZE + TCPTxDataCount, 1);
+  TCPCompleteHeader(TCPSocket->Header, TxFrame1SeqNr, TCPAckNr,
+    0x5000 | TCP_CODE_ACK, Window,               // TCP header length = 20
+    TxFrame1Size - ETH_HEADER_SIZE - IP_HEADER_SIZE,
+    TxFrame1DataSum);                            // (the data was summed up already)
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
-// calculates the TCP/IP checksum. if 'IsTCP != 0', the TCP pseudo-header
-// will be included.
-//------------------------------------------------------------------------------
-static unsigned int CalcChecksum(void *Start, unsigned int Count,
-  unsigned char IsTCP)
-{
-  unsigned long Sum = 0;
-  unsigned int *pStart = Start;
-
-  if (IsTCP)
-  {                                              // if we've a TCP frame...
-    Sum += MyIP[0];                              // ...include TCP pseudo-header
-    Sum += MyIP[1];
-    Sum += RemoteIP[0];
-    Sum += RemoteIP[1];
-    Sum += __swap_bytes(Count);                  // TCP header length plus data length
-    Sum += SWAPB(PROT_TCP);
-  }
-
-  while (Count > 1)                              // sum words
-  {                            
-    Sum += *pStart++;
-    Count -= 2;
-  }
+// copies a frame template ('Count' bytes, even) to TxFrame2
+//------------------------------------------------------------------------------
+static void CopyTemplate(const unsigned int *Template, unsigned int Count)
+{
+  unsigned int *pDest = TxFrame2Mem;
 
-  if (Count)                                     // add left-over byte, if any
-    Sum += *(unsigned char *)pStart;
-  
- while (Sum >> 16)                              // fold 32-bit sum to 16 bits
+  for (Count >>= 1; Count; Count--)
+    *pDest++ = *Template++;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// builds the header template of the selected socket as soon as the other
+// TCP's MAC, IP and port are known. the fields which change from frame to
+// frame are left 0, so 'IPSum' and 'TCPSum' (incl. the pseudo-header w/o
+// length) cover the constant fields only.
+//------------------------------------------------------------------------------
+static void TCPBuildHeader(void)
+{
+  unsigned int *Header = TCPSocket->Header;
+  unsigned char i;
+
+  for (i = 0; i < TCP_DATA_OFS / 2; i++)
+    Header[i] = 0;
+
+  // Ethernet
+  ACCESS_UINT(*Header, ETH_DA_OFS) = RemoteMAC[0];
+  ACCESS_UINT(*Header, ETH_DA_OFS + 2) = RemoteMAC[1];
+  ACCESS_UINT(*Header, ETH_DA_OFS + 4) = RemoteMAC[2];
+  ACCESS_UINT(*Header, ETH_SA_OFS) = MyMAC[0];
+  ACCESS_UINT(*Header, ETH_SA_OFS + 2) = MyMAC[1];
+  ACCESS_UINT(*Header, ETH_SA_OFS + 4) = MyMAC[2];
+  ACCESS_UINT(*Header, ETH_TYPE_OFS) = SWAPB(FRAME_IP);
+
+  // IP
+  ACCESS_UINT(*Header, IP_VER_IHL_TOS_OFS) = SWAPB(IP_VER_IHL);
+  ACCESS_UINT(*Header, IP_TTL_PROT_OFS) = SWAPB((DEFAULT_TTL << 8) | PROT_TCP);
+  ACCESS_UINT(*Header, IP_SOURCE_OFS) = MyIP[0];
+  ACCESS_UINT(*Header, IP_SOURCE_OFS + 2) = MyIP[1];
+  ACCESS_UINT(*Header, IP_DESTINATION_OFS) = RemoteIP[0];
+  ACCESS_UINT(*Header, IP_DESTINATION_OFS + 2) = RemoteIP[1];
+  TCPSocket->IPSum = ChecksumAdd((unsigned char *)Header + IP_VER_IHL_TOS_OFS,
+    IP_HEADER_SIZE, 0);
+
+  // TCP
+  ACCESS_UINT(*Header, TCP_SRCPORT_OFS) = __swap_bytes(TCPLocalPort);
+  ACCESS_UINT(*Header, TCP_DESTPORT_OFS) = __swap_bytes(TCPRemotePort);
+  TCPSocket->TCPSum = ChecksumAdd((unsigned char *)Header + TCP_SRCPORT_OFS,
+    TCP_HEADER_SIZE, PseudoSum(RemoteIP, PROT_TCP, 0, 0));
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// fills in the variable fields of a copy of the selected socket's header
+// template (or of the template itself). the checksums are not recalculated
+// over the whole header, the new values are just added to the sums of the
+// constant fields (RFC 1624, the fields were 0 when the sums were taken).
+// 'Length' is the TCP header length plus data length, 'DataSum' the sum
+// of the options and data.
+//------------------------------------------------------------------------------
+static void TCPCompleteHeader(unsigned int *Header, unsigned long SeqNr, unsigned long AckNr,
+  unsigned int Code, unsigned int Window, unsigned int Length, unsigned int DataSum)
+{
+  unsigned long Sum;
+
+  // IP
+  ACCESS_UINT(*Header, IP_TOTAL_LENGTH_OFS) = __swap_bytes(IP_HEADER_SIZE + Length);
+  ACCESS_UINT(*Header, IP_HEAD_CHKSUM_OFS) = ~ChecksumFold((unsigned long)TCPSocket->IPSum +
+    ACCESS_UINT(*Header, IP_TOTAL_LENGTH_OFS));
+
+  // TCP
+  WriteDWBE((unsigned char *)Header + TCP_SEQNR_OFS, SeqNr);
+  WriteDWBE((unsigned char *)Header + TCP_ACKNR_OFS, AckNr);
+  ACCESS_UINT(*Header, TCP_DATA_CODE_OFS) = __swap_bytes(Code);
+  ACCESS_UINT(*Header, TCP_WINDOW_OFS) = __swap_bytes(Window);  // data bytes to accept
+
+  Sum = (unsigned long)TCPSocket->TCPSum + DataSum;
+  Sum += __swap_bytes(Length);                   // pseudo-header's length
+  Sum += ACCESS_UINT(*Header, TCP_SEQNR_OFS);
+  Sum += ACCESS_UINT(*Header, TCP_SEQNR_OFS + 2);
+  Sum += ACCESS_UINT(*Header, TCP_ACKNR_OFS);
+  Sum += ACCESS_UINT(*Header, TCP_ACKNR_OFS + 2);
+  Sum += ACCESS_UINT(*Header, TCP_DATA_CODE_OFS);
+  Sum += ACCESS_UINT(*Header, TCP_WINDOW_OFS);
+  ACCESS_UINT(*Header, TCP_CHKSUM_OFS) = ~ChecksumFold(Sum);
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function (MSP430 assembly, arguments in R12..R14)
+// adds 'Count' bytes at 'Start' (word-aligned) to the one's complement sum
+// 'Sum' and returns the new sum. instead of a 32 bit add per word (~8 cycles
+// in C), the words are chained with ADDC (2 cycles each), 16 bytes per pass.
+// the carry out of a pass is counted in R15 and added at the end.
+//------------------------------------------------------------------------------
+asm("            .global ChecksumAdd");
+asm("ChecksumAdd:");
+asm("            clr.w   R15                         ; carries out of the ADDC chains");
+asm("            sub.w   #16,R13                     ; 16 bytes per pass");
+asm("            jlo     ChecksumRest");
+asm("ChecksumLoop:");
+asm("            add.w   @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            adc.w   R15                         ; keep the carry (SUB overwrites it)");
+asm("            sub.w   #16,R13");
+asm("            jhs     ChecksumLoop");
+asm("ChecksumRest:");
+asm("            bit.w   #8,R13                      ; R13 & 15 = bytes left");
+asm("            jz      ChecksumRest4");
+asm("            add.w   @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            adc.w   R15");
+asm("ChecksumRest4:");
+asm("            bit.w   #4,R13");
+asm("            jz      ChecksumRest2");
+asm("            add.w   @R12+,R14");
+asm("            addc.w  @R12+,R14");
+asm("            adc.w   R15");
+asm("ChecksumRest2:");
+asm("            bit.w   #2,R13");
+asm("            jz      ChecksumRest1");
+asm("            add.w   @R12+,R14");
+asm("            adc.w   R15");
+asm("ChecksumRest1:");
+asm("            bit.w   #1,R13                      ; add left-over byte, if any");
+asm("            jz      ChecksumDone");
+asm("            mov.b   @R12,R13                    ; (it's the low-byte)");
+asm("            add.w   R13,R14");
+asm("            adc.w   R15");
+asm("ChecksumDone:");
+asm("            add.w   R15,R14                     ; end-around carry");
+asm("            adc.w   R14");
+asm("            mov.w   R14,R12                     ; return the sum");
+asm("            ret     ");
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// adds 'Count' bytes at 'Start' (any address, e.g. flash) to the one's
+// complement sum 'Sum' and returns the new sum. 'Ofs' is the offset of the
+// bytes in the segment, at odd offsets they are high-bytes.
+//------------------------------------------------------------------------------
+static unsigned int ChecksumAddConst(const unsigned char *Start, unsigned int Count,
+  unsigned int Ofs, unsigned int Sum)
+{
+  unsigned long NewSum = Sum;
+
+  if ((Ofs & 1) && Count)                        // odd offset, the 1st byte is
+  {                                              // a high-byte
+    NewSum += (unsigned int)*Start++ << 8;
+    Count--;
+  }
+
+  while (Count > 1)                              // sum byte pairs
   {
-      Sum = (Sum & 0xFFFF) + (Sum >> 16);
+    NewSum += *Start++;
+    NewSum += (unsigned int)*Start++ << 8;
+    Count -= 2;
   }
-  return ~Sum;
+
+  if (Count)                                     // add left-over byte, if any
+    NewSum += *Start;
+
+  return ChecksumFold(NewSum);
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// adds the pseudo-header of a TCP segment or UDP datagram ('Protocol')
+// between us and 'IP' with 'Length' bytes (header plus data) to the one's
+// complement sum 'Sum'
+//------------------------------------------------------------------------------
+static unsigned int PseudoSum(const unsigned int *IP, unsigned int Protocol,
+  unsigned int Length, unsigned int Sum)
+{
+  unsigned long NewSum = Sum;
+
+  NewSum += MyIP[0];
+  NewSum += MyIP[1];
+  NewSum += IP[0];
+  NewSum += IP[1];
+  NewSum += __swap_bytes(Length);                // header length plus data length
+  NewSum += __swap_bytes(Protocol);
+
+  return ChecksumFold(NewSum);
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// folds a 32-bit sum to 16 bits (end-around carry)
+//------------------------------------------------------------------------------
+static unsigned int ChecksumFold(unsigned long Sum)
+{
+  while (Sum >> 16)
+    Sum = (Sum & 0xFFFF) + (Sum >> 16);
+
+  return Sum;
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
@@ -994,7 +1865,7 @@ static unsigned int CalcChecksum(void *Start, unsigned int Count,
 //------------------------------------------------------------------------------
 static void TCPStartRetryTimer(void)
 {
-  TCPTimer = 0;
+  TCPSocket->TimerStart = TCPTimer;
   RetryCounter = MAX_RETRYS;
   TCPFlags |= TCP_TIMER_RUNNING;
   TCPFlags |= TIMER_TYPE_RETRY;
@@ -1005,7 +1876,7 @@ static void TCPStartRetryTimer(void)
 //------------------------------------------------------------------------------
 static void TCPStartFinTimer(void)
 {
-  TCPTimer = 0;
+  TCPSocket->TimerStart = TCPTimer;
   TCPFlags |= TCP_TIMER_RUNNING;
   TCPFlags &= ~TIMER_TYPE_RETRY;  
 }
@@ -1015,7 +1886,7 @@ static void TCPStartFinTimer(void)
 //------------------------------------------------------------------------------
 static void TCPRestartTimer(void)
 {
-  TCPTimer = 0;
+  TCPSocket->TimerStart = TCPTimer;
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
@@ -1032,10 +1903,12 @@ static void TCPStopTimer(void)
 //------------------------------------------------------------------------------
 static void TCPHandleRetransmission(void)
 {
+  TCPFlags &= ~TCP_RTT_MEASURING;                // don't time retransmitted frames (Karn)
+
   switch (LastFrameSent)
   {
     case ARP_REQUEST :
-      PrepareARP_REQUEST();
+      PrepareARP_REQUEST(NextHopIP(RemoteIP));
       break;
     case TCP_SYN_FRAME :
       PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_SYN);
@@ -1047,8 +1920,11 @@ static void TCPHandleRetransmission(void)
       PrepareTCP_FRAME(TCPSeqNr, TCPAckNr, TCP_CODE_FIN | TCP_CODE_ACK);
       break; 
     case TCP_DATA_FRAME :
-      TransmitControl |= SEND_FRAME1;
+      TCPRewindTx();                             // go back to the oldest unacked byte
       break;
+    case TCP_WINDOW_PROBE :                      // an old sequence nr., so the other
+      PrepareTCP_FRAME(TCPSeqNr - 1, TCPAckNr, TCP_CODE_ACK);  // TCP has to answer with
+      break;                                     // its current window
   }
 }
 
@@ -1063,6 +1939,108 @@ asm("            swpb    R14                         ; Restore R15");
 asm("            ret");
 //------------------------------------------------------------------------------
 // easyWEB internal function
+// resets the transmit window when a new connection is set up
+//------------------------------------------------------------------------------
+static void TCPResetTx(void)
+{
+  TxSegHead = 0;
+  TxSegCount = 0;
+  TCPSocket->DupAcks = 0;
+  TCPTxRewind = 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// the other TCP has ACKed our data up to (not including) 'AckNr':
+// forget all segments in flight which are completely ACKed
+//------------------------------------------------------------------------------
+static void TCPAckTxSegments(unsigned long AckNr)
+{
+  while (TxSegCount &&
+         ((unsigned long)(TxSegEnd[TxSegHead] - TCPSeqNr) <= (unsigned long)(AckNr - TCPSeqNr)))
+  {
+    if (++TxSegHead == TCP_MAX_SEGS_IN_FLIGHT) TxSegHead = 0;
+    TxSegCount--;
+  }
+
+  TCPSeqNr = AckNr;                              // new oldest unacked byte
+  TCPSocket->DupAcks = 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// gives the TX buffer back to the user if another segment fits into the
+// window: a full one behind the segments in flight, else whatever the window
+// allows ('TCPTxWindow'). a zero window starts the persist timer, which
+// probes it until the other TCP opens it again.
+//------------------------------------------------------------------------------
+static void TCPCheckTxWindow(void)
+{
+  if ((TCPStateMachine != ESTABLISHED) && (TCPStateMachine != CLOSE_WAIT))
+    return;
+
+  if (TransmitControl & SEND_FRAME1)             // last segment still in TxFrame1
+    return;
+
+  if (TxSegCount)
+  {
+    if (TxSegCount >= TCP_MAX_SEGS_IN_FLIGHT)    // too many segments in flight
+      return;
+
+    if ((unsigned long)(TCPUNASeqNr - TCPSeqNr) + MAX_TCP_TX_DATA_SIZE > TCPSndWnd)
+      return;                                    // a full segment won't fit the window
+
+    TCPTxWindow = MAX_TCP_TX_DATA_SIZE;
+  }
+  else if (!TCPSndWnd)                           // window closed, nothing in flight
+  {
+    if (!(TCPFlags & TCP_TIMER_RUNNING))
+      TCPStartRetryTimer();
+    LastFrameSent = TCP_WINDOW_PROBE;            // (a running retry timer probes, too)
+    return;
+  }
+  else
+    TCPTxWindow = TCPSndWnd < MAX_TCP_TX_DATA_SIZE ? TCPSndWnd : MAX_TCP_TX_DATA_SIZE;
+
+  if (LastFrameSent == TCP_WINDOW_PROBE)         // window open again: the connection
+    TCPSocket->IdleStart = TCPTimer;             // wasn't idle, it waited for the other TCP
+
+  SocketStatus |= SOCK_TX_BUF_RELEASED;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// TxFrame1 is free again (sent or dropped): checks for all sockets if they may
+// send the next segment. the selected socket stays selected.
+//------------------------------------------------------------------------------
+static void TCPReleaseTxFrame1(void)
+{
+  TTCPSocket *Socket = TCPSocket;
+
+  for (TCPSocket = TCPSockets; TCPSocket < TCPSockets + TCP_MAX_SOCKETS; TCPSocket++)
+    TCPCheckTxWindow();
+
+  TCPSocket = Socket;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// retransmission of data: forget all segments in flight and go back to the
+// oldest unacked byte. the user has to send 'TCPTxRewind' bytes again.
+//------------------------------------------------------------------------------
+static void TCPRewindTx(void)
+{
+  TCPTxRewind += TCPUNASeqNr - TCPSeqNr;         // includes a frame not sent yet
+  TCPUNASeqNr = TCPSeqNr;
+  TxSegCount = 0;
+  TCPFlags &= ~TCP_RTT_MEASURING;                // don't time retransmitted data (Karn)
+
+  if ((TransmitControl & SEND_FRAME1) && (TxFrame1Socket == TCPSocket))
+  {                                              // drop our segment not sent yet,
+    TransmitControl &= ~SEND_FRAME1;             // the others may use TxFrame1 now
+    TCPReleaseTxFrame1();
+  }
+  else
+    TCPCheckTxWindow();
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
 // if all retransmissions failed, close connection and indicate an error
 //------------------------------------------------------------------------------
 static void TCPHandleTimeout(void)
@@ -1078,15 +2056,570 @@ static void TCPHandleTimeout(void)
 }
 //------------------------------------------------------------------------------
 // easyWEB internal function
-// function executed every 0.262s by the MCU. used for the
-// inital sequence number generator (ISN) and the TCP-timer
-//------------------------------------------------------------------------------
-//#pragma vector = TIMERA1_VECTOR
-//__interrupt void TCPClockHandler(void)
-//{
- // if (TAIV == 10)                                // check for timer overflow, reset int.-flag
-  //{
-   // ISNGenHigh++;                                // upper 16 bits of initial sequence number
-   // TCPTimer++;                                  // timer for retransmissions
- // }
-//}
+// selects the socket an incoming segment belongs to:
+// 1. the connection with the segment's 4-tuple
+// 2. a socket listening on the destination port (new connection)
+// 3. a closed socket that used the port, to answer with a reset
+// SYNs are not reset if all listeners are busy, the other TCP retries.
+// returns 0 if the segment has to be dropped.
+//------------------------------------------------------------------------------
+static unsigned char TCPDemultiplex(unsigned int SourcePort, unsigned int DestPort,
+  unsigned int TCPCode)
+{
+  TTCPSocket *Listener = 0;
+  TTCPSocket *Closed = 0;
+
+  for (TCPSocket = TCPSockets; TCPSocket < TCPSockets + TCP_MAX_SOCKETS; TCPSocket++)
+  {
+    if (TCPLocalPort != DestPort) continue;
+
+    switch (TCPStateMachine)
+    {
+      case CLOSED :
+        if (!Closed) Closed = TCPSocket;
+        break;
+      case LISTENING :
+        if (!Listener) Listener = TCPSocket;
+        break;
+      default :
+        if ((TCPRemotePort == SourcePort) &&
+            (RemoteIP[0] == RecdFrameIP[0]) && (RemoteIP[1] == RecdFrameIP[1]))
+          return 1;                              // segment of an existing connection
+    }
+  }
+
+  if (Listener)
+    TCPSocket = Listener;
+  else if (Closed && ((TCPCode & (TCP_CODE_SYN | TCP_CODE_ACK)) != TCP_CODE_SYN))
+    TCPSocket = Closed;
+  else
+    return 0;
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// looks for room for a record with 'Count' data bytes in the receive ring,
+// returns its offset (the data goes behind the header word) or
+// 'RX_RING_NO_ROOM'. the ring isn't changed, so the data of a segment can
+// be copied there before it is known whether the segment is acceptable.
+//------------------------------------------------------------------------------
+static unsigned int RxRingReserve(unsigned int Count)
+{
+  unsigned int Size = 2 + ((Count + 1) & ~1);    // header + data, even size
+
+  if (Size > TCP_RX_BUF_SIZE) return RX_RING_NO_ROOM;  // (no ring at all?)
+  if (!RxRingUsed) return 0;                     // ring empty? start at the beginning
+
+  if (RxRingTail <= RxRingHead)                  // free space between tail and head
+    return (RxRingHead - RxRingTail < Size) ? RX_RING_NO_ROOM : RxRingTail;
+
+  if (TCP_RX_BUF_SIZE - RxRingTail >= Size)      // free space behind the tail
+    return RxRingTail;
+
+  return (RxRingHead < Size) ? RX_RING_NO_ROOM : 0;  // try the beginning of the ring
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// keeps the data of the just received segment, which has been copied to
+// the record at 'Ofs' (see RxRingReserve()). the ring is shared by all
+// sockets, each segment gets a contiguous record so that the user can
+// read it via 'TCP_RX_BUF'.
+//------------------------------------------------------------------------------
+static void RxRingPut(unsigned int Ofs, unsigned int Count)
+{
+  unsigned int Size = 2 + ((Count + 1) & ~1);    // header + data, even size
+
+  if (!RxRingUsed)                               // ring empty? start at the beginning
+  {
+    RxRingHead = 0;
+    RxRingTail = 0;
+  }
+  else if (Ofs != RxRingTail)                    // record at the beginning of the ring?
+  {
+    ACCESS_UINT(RxTCPBufferMem, RxRingTail) =    // skip the rest of the ring
+      RX_REC_RELEASED | (TCP_RX_BUF_SIZE - RxRingTail - 2);
+    RxRingUsed += TCP_RX_BUF_SIZE - RxRingTail;
+    RxRingTail = 0;
+  }
+
+  ACCESS_UINT(RxTCPBufferMem, RxRingTail) =
+    ((unsigned int)(TCPSocket - TCPSockets) << RX_REC_SOCKET_SHIFT) | Count;
+
+  if (!(SocketStatus & SOCK_DATA_AVAILABLE))     // user waits for data? pass it on
+  {
+    TCPSocket->RxOfs = RxRingTail + 2;
+    TCPRxDataCount = Count;
+    SocketStatus |= SOCK_DATA_AVAILABLE;
+  }
+
+  RxRingUsed += Size;
+  RxRingTail += Size;
+  if (RxRingTail == TCP_RX_BUF_SIZE) RxRingTail = 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// gives the segment in 'TCP_RX_BUF' (if 'All' is set: all segments) of the
+// selected socket back to the receive ring and passes the next segment of
+// this socket to the user
+//------------------------------------------------------------------------------
+static void RxRingRelease(unsigned char All)
+{
+  unsigned int Owner = (unsigned int)(TCPSocket - TCPSockets) << RX_REC_SOCKET_SHIFT;
+  unsigned int Ofs = RxRingHead;
+  unsigned int Left = RxRingUsed;
+  unsigned int Header;
+
+  if (SocketStatus & SOCK_DATA_AVAILABLE)
+    ACCESS_UINT(RxTCPBufferMem, TCPSocket->RxOfs - 2) |= RX_REC_RELEASED;
+  SocketStatus &= ~SOCK_DATA_AVAILABLE;
+
+  while (Left)                                   // look for the socket's next segment
+  {
+    Header = ACCESS_UINT(RxTCPBufferMem, Ofs);
+
+    if (!(Header & RX_REC_RELEASED) && ((Header & RX_REC_SOCKET_MASK) == Owner))
+    {
+      if (All)
+        ACCESS_UINT(RxTCPBufferMem, Ofs) |= RX_REC_RELEASED;
+      else
+      {
+        TCPSocket->RxOfs = Ofs + 2;
+        TCPRxDataCount = Header & RX_REC_LENGTH_MASK;
+        SocketStatus |= SOCK_DATA_AVAILABLE;
+        break;
+      }
+    }
+
+    Left -= RX_REC_SIZE(Header);
+    Ofs += RX_REC_SIZE(Header);
+    if (Ofs == TCP_RX_BUF_SIZE) Ofs = 0;
+  }
+
+  while (RxRingUsed)                             // free released records at the head
+  {
+    Header = ACCESS_UINT(RxTCPBufferMem, RxRingHead);
+    if (!(Header & RX_REC_RELEASED)) break;
+
+    RxRingUsed -= RX_REC_SIZE(Header);
+    RxRingHead += RX_REC_SIZE(Header);
+    if (RxRingHead == TCP_RX_BUF_SIZE) RxRingHead = 0;
+  }
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns the window we advertise: the nr. of full segments the receive
+// ring can take (all sockets share it). smaller windows are not offered,
+// they only invite tiny segments (silly window syndrome, RFC 1122, 4.2.3.3)
+//------------------------------------------------------------------------------
+static unsigned int TCPRxWindow(void)
+{
+  unsigned int Room;
+  unsigned int Window = 0;
+
+  if (TCPRxHandler) return TCP_RX_STREAM_WINDOW;  // data is read at once, no ring needed
+
+  if (!RxRingUsed)
+    Room = TCP_RX_BUF_SIZE;
+  else if (RxRingTail > RxRingHead)              // free space behind the tail and
+  {                                              // at the beginning of the ring
+    Room = TCP_RX_BUF_SIZE - RxRingTail;
+    if (RxRingHead > Room) Room = RxRingHead;
+  }
+  else
+    Room = RxRingHead - RxRingTail;
+
+  while (Room >= MAX_TCP_RX_DATA_SIZE + 2)       // each segment needs a record header
+  {
+    Window += MAX_TCP_RX_DATA_SIZE;
+    Room -= MAX_TCP_RX_DATA_SIZE + 2;
+  }
+
+  return Window;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns 1 if the state machine of the selected socket will take the data
+// of the just received segment (see ProcessTCPFrame()): the next bytes we
+// expect, in a state that allows receiving data. checked before the data
+// is read, so that a receive handler only sees data it can keep.
+//------------------------------------------------------------------------------
+static unsigned char TCPRxAcceptable(unsigned long SegSeq, unsigned long SegAck,
+  unsigned int TCPCode)
+{
+  if ((TCPCode & (TCP_CODE_RST | TCP_CODE_SYN | TCP_CODE_ACK)) != TCP_CODE_ACK)
+    return 0;
+  if (SegSeq != TCPAckNr) return 0;
+
+  switch (TCPStateMachine)
+  {
+    case SYN_RECD :                              // the ACK of our SYN completes the
+      return SegAck == TCPUNASeqNr;              // handshake
+    case ESTABLISHED :
+    case FIN_WAIT_1 :
+    case FIN_WAIT_2 :
+      return 1;
+  }
+  return 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// passes the data of the just received segment ('Count' bytes) to the
+// receive handler of the selected socket (see TCPReadRx()) and skips what
+// it hasn't read. returns 'Sum' plus all data bytes.
+//------------------------------------------------------------------------------
+static unsigned int TCPStreamRx(unsigned int Count, unsigned int Sum)
+{
+  RxStreamBegin(Count, Sum);
+  TCPRxHandler(TCPSocket - TCPSockets, Count);
+  return RxStreamEnd();
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// lets TCPReadRx() read the next 'Count' bytes of the frame, 'Sum' is the
+// checksum of what comes before them
+//------------------------------------------------------------------------------
+static void RxStreamBegin(unsigned int Count, unsigned int Sum)
+{
+  RxStreamLeft = Count;
+  RxStreamSum = Sum;
+  RxStreamOdd = 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// skips what a receive handler hasn't read of the bytes of RxStreamBegin()
+// and returns the checksum including all of them
+//------------------------------------------------------------------------------
+static unsigned int RxStreamEnd(void)
+{
+  unsigned int Sum;
+
+  if (RxStreamOdd) RxStreamLeft--;               // high-byte is summed up already
+  Sum = DummyReadFrameSum8900(RxStreamLeft, RxStreamSum);
+  RxStreamLeft = 0;                              // TCPReadRx() ends here
+
+  return Sum;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// sends a window update if the window of the selected socket can be opened
+// by at least a full segment
+//------------------------------------------------------------------------------
+static void TCPWindowUpdate(void)
+{
+  if ((TCPStateMachine != ESTABLISHED) && (TCPStateMachine != FIN_WAIT_1) &&
+      (TCPStateMachine != FIN_WAIT_2))
+    return;                                      // no data expected anymore
+
+  if ((signed int)((unsigned int)TCPAckNr + TCPRxWindow() - TCPSocket->RcvEdge) >=
+      MAX_TCP_RX_DATA_SIZE)
+    PrepareTCP_FRAME(TCPUNASeqNr, TCPAckNr, TCP_CODE_ACK);
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns the IP whose MAC is needed to reach 'IP': 'IP' itself if it is
+// part of our subnet, else the gateway's IP
+//------------------------------------------------------------------------------
+static const unsigned int *NextHopIP(const unsigned int *IP)
+{
+  if (((IP[0] ^ MyIP[0]) & SubnetMask[0]) ||
+      ((IP[1] ^ MyIP[1]) & SubnetMask[1]))
+    return GatewayIP;
+
+  return IP;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// stores (or refreshes) the MAC of 'IP' in the ARP cache. if the cache is
+// full, the entry closest to expiry is replaced.
+//------------------------------------------------------------------------------
+static void ARPCacheUpdate(const unsigned int *IP, const unsigned int *MAC)
+{
+  TARPCacheEntry *Entry = ARPCache;
+  unsigned char i;
+
+  for (i = 0; i < ARP_CACHE_SIZE; i++)
+  {
+    if (ARPCache[i].TTL && (ARPCache[i].IP[0] == IP[0]) && (ARPCache[i].IP[1] == IP[1]))
+    {
+      Entry = &ARPCache[i];                      // known IP, refresh it
+      break;
+    }
+
+    if (ARPCache[i].TTL < Entry->TTL)            // else take a free or the oldest one
+      Entry = &ARPCache[i];
+  }
+
+  Entry->IP[0] = IP[0];
+  Entry->IP[1] = IP[1];
+  Entry->MAC[0] = MAC[0];
+  Entry->MAC[1] = MAC[1];
+  Entry->MAC[2] = MAC[2];
+  Entry->TTL = ARP_CACHE_TTL;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns the cached MAC of 'IP', or 0 if we have to ask by ARP
+//------------------------------------------------------------------------------
+static const unsigned int *ARPCacheLookup(const unsigned int *IP)
+{
+  unsigned char i;
+
+  for (i = 0; i < ARP_CACHE_SIZE; i++)
+    if (ARPCache[i].TTL && (ARPCache[i].IP[0] == IP[0]) && (ARPCache[i].IP[1] == IP[1]))
+      return ARPCache[i].MAC;
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// ages the ARP cache once per 'ARP_AGING_INTERVAL', so a host that changed
+// its MAC is asked again after 'ARP_CACHE_TTL' intervals at the latest
+//------------------------------------------------------------------------------
+static void ARPCacheAging(void)
+{
+  unsigned char i;
+
+  if ((unsigned int)(TCPTimer - ARPAgingStart) < ARP_AGING_INTERVAL)
+    return;
+
+  ARPAgingStart = TCPTimer;
+
+  for (i = 0; i < ARP_CACHE_SIZE; i++)
+    if (ARPCache[i].TTL)
+      ARPCache[i].TTL--;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns the nr. of ticks TCPIdle() may sleep before DoNetworkStuff() has
+// to run again (0 = until a frame comes in)
+//------------------------------------------------------------------------------
+static unsigned int TCPIdleTicks(void)
+{
+  TTCPSocket *Socket;
+  unsigned int Ticks = 0;
+  unsigned int Elapsed;
+  unsigned char i;
+
+  for (Socket = TCPSockets; Socket < TCPSockets + TCP_MAX_SOCKETS; Socket++)
+    if (Socket->Flags & (TCP_TIMER_RUNNING | TCP_ACK_PENDING))
+      return 1;                                  // timeouts are checked each tick
+
+  for (i = 0; i < ARP_CACHE_SIZE; i++)
+    if (ARPCache[i].TTL)                         // cache has to be aged?
+    {
+      Elapsed = TCPTimer - ARPAgingStart;
+      Ticks = Elapsed < ARP_AGING_INTERVAL ? ARP_AGING_INTERVAL - Elapsed : 1;
+      break;
+    }
+
+  for (Socket = TCPSockets; Socket < TCPSockets + TCP_MAX_SOCKETS; Socket++)
+    if (Socket->IdleTimeout && (Socket->State == ESTABLISHED))
+    {                                            // connection has to be closed when idle?
+      Elapsed = TCPTimer - Socket->IdleStart;
+      Elapsed = Elapsed < Socket->IdleTimeout ? Socket->IdleTimeout - Elapsed : 1;
+      if (!Ticks || Elapsed < Ticks) Ticks = Elapsed;
+    }
+
+  if (CS8900_SLEEP_TIME && !Sleeping8900 && !TCPConnected())
+  {                                              // CS8900 has to be put to sleep?
+    Elapsed = TCPTimer - LastTrafficTime;
+    Elapsed = Elapsed < CS8900_SLEEP_TIME ? CS8900_SLEEP_TIME - Elapsed : 1;
+    if (!Ticks || Elapsed < Ticks) Ticks = Elapsed;
+  }
+
+  return Ticks;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns 1 if a socket is neither CLOSED nor LISTENING
+//------------------------------------------------------------------------------
+static unsigned char TCPConnected(void)
+{
+  TTCPSocket *Socket;
+
+  for (Socket = TCPSockets; Socket < TCPSockets + TCP_MAX_SOCKETS; Socket++)
+    if ((Socket->State != CLOSED) && (Socket->State != LISTENING))
+      return 1;
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// returns Timer_A's count extended to 32 bit by the overflow counter
+// (4us units). interrupts must be disabled.
+//------------------------------------------------------------------------------
+static unsigned long TCPClock(void)
+{
+  unsigned int High = ISNGenHigh;
+  unsigned int Low = TAR;
+
+  if ((TACTL & TAIFG) && !(Low & 0x8000))        // overflow not counted yet?
+    High++;
+
+  return ((unsigned long)High << 16) | Low;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// resets the round-trip time estimator of a new connection
+//------------------------------------------------------------------------------
+static void TCPInitRTO(void)
+{
+  TCPFlags &= ~(TCP_RTT_MEASURING | TCP_RTT_VALID);
+  TCPSocket->RTO = TCP_INITIAL_RTO;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// starts timing the segment just sent (up to 'TCPUNASeqNr') unless another
+// one is timed already
+//------------------------------------------------------------------------------
+static void TCPStartRTTMeasurement(void)
+{
+  if (!(TCPFlags & TCP_RTT_MEASURING))
+  {
+    TCPSocket->RTTSeqNr = TCPUNASeqNr;
+    TCPSocket->RTTStart = TCPTimer;
+    TCPFlags |= TCP_RTT_MEASURING;
+  }
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// new data was ACKed up to 'AckNr' (must be called before 'TCPSeqNr' is
+// advanced). if the segment being timed is ACKed, its round-trip time
+// updates SRTT and RTTVAR as described in RFC 6298. the RTO is derived
+// from them again, which also ends a backoff.
+//------------------------------------------------------------------------------
+static void TCPUpdateRTO(unsigned long AckNr)
+{
+  unsigned int RTT;
+  int Err;
+
+  if (TCPFlags & TCP_RTT_MEASURING)
+    if ((unsigned long)(AckNr - TCPSeqNr) >= (unsigned long)(TCPSocket->RTTSeqNr - TCPSeqNr))
+    {                                            // timed segment ACKed?
+      TCPFlags &= ~TCP_RTT_MEASURING;
+      RTT = TCPTimer - TCPSocket->RTTStart;
+      if (RTT > TCP_MAX_RTO) RTT = TCP_MAX_RTO;
+
+      if (TCPFlags & TCP_RTT_VALID)
+      {
+        Err = RTT - (TCPSocket->SRTT >> 3);
+        TCPSocket->SRTT += Err;                  // SRTT = 7/8 SRTT + 1/8 RTT
+        if (Err < 0) Err = -Err;
+        TCPSocket->RTTVAR += Err - (TCPSocket->RTTVAR >> 2);  // RTTVAR = 3/4 RTTVAR + 1/4 |Err|
+      }
+      else
+      {
+        TCPSocket->SRTT = RTT << 3;              // 1st measurement
+        TCPSocket->RTTVAR = RTT << 1;            // RTTVAR = RTT / 2
+        TCPFlags |= TCP_RTT_VALID;
+      }
+    }
+
+  if (!(TCPFlags & TCP_RTT_VALID))
+  {
+    TCPSocket->RTO = TCP_INITIAL_RTO;            // nothing measured yet
+    return;
+  }
+
+  TCPSocket->RTO = (TCPSocket->SRTT >> 3) +      // RTO = SRTT + max(G, 4 x RTTVAR)
+    (TCPSocket->RTTVAR ? TCPSocket->RTTVAR : 1);
+
+  if (TCPSocket->RTO < TCP_MIN_RTO) TCPSocket->RTO = TCP_MIN_RTO;
+  if (TCPSocket->RTO > TCP_MAX_RTO) TCPSocket->RTO = TCP_MAX_RTO;
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// rec'd data has to be ACKed: the ACK is delayed up to 'TCP_DELAYED_ACK_TIME'
+// so that it can ride on the answer in TxFrame1. every 2nd segment is ACKed
+// at once (RFC 1122, 4.2.3.2)
+//------------------------------------------------------------------------------
+static void TCPDelayAck(void)
+{
+  if (TCP_DELAYED_ACK_TIME && !(TCPFlags & TCP_ACK_PENDING))
+  {
+    TCPSocket->AckTimerStart = TCPTimer;
+    TCPFlags |= TCP_ACK_PENDING;
+  }
+  else
+    PrepareTCP_FRAME(TCPUNASeqNr, TCPAckNr, TCP_CODE_ACK);
+}
+//------------------------------------------------------------------------------
+// easyWEB internal function
+// Timer_A interrupt. CCR1 fires each 'TCP_TICK' (10ms) for the TCP-timer,
+// the overflow every 0.262s is used for the inital sequence number
+// generator (ISN)
+//------------------------------------------------------------------------------
+#pragma vector = TIMERA1_VECTOR
+__interrupt void TCPClockHandler(void)
+{
+  switch (TAIV)                                  // reset int.-flag
+  {
+    case 2 :                                     // CCR1
+      CCR1 += TCP_TICK;
+      TCPTimer++;                                // timer for retransmissions
+      if (TCPWakeupTicks && !--TCPWakeupTicks)   // TCPIdle() has to return?
+        __bic_SR_register_on_exit(LPM3_bits);
+      break;
+    case 10 :                                    // timer overflow
+      ISNGenHigh++;                              // upper 16 bits of initial sequence number
+      break;
+  }
+}
+#ifdef CHECKSUM_BENCHMARK
+//------------------------------------------------------------------------------
+// measures the C loop and the ADDC chains of ChecksumAdd() in MCLK cycles
+// per byte (* 100) for each of 'ChecksumBenchmarkSize', the results are
+// left in 'ChecksumBenchmarkResult'
+//------------------------------------------------------------------------------
+static void BenchmarkChecksum(void)
+{
+  unsigned char i;
+
+  for (i = 0; i < CHECKSUM_BENCHMARK_SIZES; i++)
+  {
+    ChecksumBenchmarkResult.ChecksumAddC[i] =
+      ChecksumBenchmarkRun(ChecksumAddC, ChecksumBenchmarkSize[i]);
+    ChecksumBenchmarkResult.ChecksumAdd[i] =
+      ChecksumBenchmarkRun(ChecksumAdd, ChecksumBenchmarkSize[i]);
+  }
+}
+//------------------------------------------------------------------------------
+// times one sum of 'Count' bytes with Timer_B (ACLK), returns MCLK cycles
+// per byte * 100
+//------------------------------------------------------------------------------
+static unsigned int ChecksumBenchmarkRun(unsigned int (*Add)(const void *, unsigned int,
+  unsigned int), unsigned int Count)
+{
+  unsigned int Divider = 1 << ((BCSCTL1 & (DIVA0 | DIVA1)) >> 4);  // ACLK = MCLK / Divider
+  unsigned int Ticks;
+
+  TBCTL = TBSSEL_1 + TBCLR + MC_2;               // count ACLK from 0
+  Add(ChecksumBenchmarkData, Count, 0);
+  Ticks = TBR;
+  TBCTL = 0;                                     // stop Timer_B
+
+  return (unsigned long)Ticks * Divider * 100 / Count;
+}
+//------------------------------------------------------------------------------
+// ChecksumAdd() in C (a 32 bit add per word, as CalcChecksum() of V1.0),
+// for comparison
+//------------------------------------------------------------------------------
+static unsigned int ChecksumAddC(const void *Start, unsigned int Count,
+  unsigned int Sum)
+{
+  unsigned long NewSum = Sum;
+  const unsigned int *pStart = Start;
+
+  while (Count > 1)                              // sum words
+  {
+    NewSum += *pStart++;
+    Count -= 2;
+  }
+
+  if (Count)                                     // add left-over byte, if any
+    NewSum += *(const unsigned char *)pStart;
+
+  return ChecksumFold(NewSum);
+}
+#endif
@@ -30,22 +30,62 @@
 #define GWIP_3               0
 #define GWIP_4               1
 
-#define RETRY_TIMEOUT        8                   // wait max. 8 x 262ms for an ACK (about 2 sec.)
-#define FIN_TIMEOUT          2                   // max. time to wait for an ACK of a FIN
-                                                 // before closing TCP state-machine (about 0.5 s)
+#define TCP_TICK             2500                // timer tick = 2500 x 4us = 10ms
+                                                 // (Timer_A runs at 250 kHz)
+#define TCP_INITIAL_RTO      100                 // retransmission timeout before the 1st
+                                                 // round-trip measurement (1 sec., RFC 6298)
+#define TCP_MIN_RTO          20                  // lower bound of the RTO (200ms)
+#define TCP_MAX_RTO          6000                // upper bound of the RTO backoff (60 sec.)
+#define TCP_DUP_ACK_THRESHOLD 3                  // duplicate ACKs that trigger a fast
+                                                 // retransmission
+#define TCP_DELAYED_ACK_TIME 20                  // max. time an ACK of rec'd data waits
+                                                 // for a data segment to ride on (200ms,
+                                                 // 0 = ACK each segment immediately)
+#define FIN_TIMEOUT          50                  // max. time to wait for an ACK of a FIN
+                                                 // before closing TCP state-machine (0.5 sec.)
 #define MAX_RETRYS           4                   // nr. of resendings before reset conn.
                                                  // total nr. of transmissions = MAX_RETRYS + 1
 
 #define MAX_TCP_TX_DATA_SIZE 768                 // max. outgoing TCP data size
-#define MAX_TCP_RX_DATA_SIZE 536                 // max. incoming TCP data size
+#define TCP_TX_BUF_SIZE      256                 // RAM for outgoing data ('TCP_TX_BUF'),
+                                                 // constant data is sent from flash
+                                                 // (see TCPTransmitConst())
+#define MAX_TCP_RX_DATA_SIZE 256                 // max. incoming TCP data size (our MSS)
+#define TCP_RX_BUF_SIZE      (2 * (MAX_TCP_RX_DATA_SIZE + 2))  // receive ring, shared by all
+                                                 // sockets (2 bytes overhead per segment)
                                                  // (increasing the buffer-size dramatically
                                                  // increases the transfer-speed!)
+                                                 // 0 = no ring, all sockets use a receive
+                                                 // handler (see 'TCPRxHandler')
+#define TCP_RX_STREAM_WINDOW (2 * MAX_TCP_RX_DATA_SIZE)  // window of a socket with a receive
+                                                 // handler (no RAM needed, but segments
+                                                 // out of order are dropped, so a larger
+                                                 // window only pays on lossless links)
+#define TCP_MAX_SEGS_IN_FLIGHT 4                 // max. nr. of unacknowledged data segments
+                                                 // (sliding window, 1 = stop-and-wait)
+#define TCP_MAX_SOCKETS      2                   // nr. of concurrent TCP connections (max. 8)
+                                                 // (~140 bytes of RAM each, ~180 with the
+                                                 // HTTP server)
+#define UDP_MAX_SOCKETS      2                   // nr. of UDP ports that can be bound
+                                                 // (see UDPBind())
+#define MAX_UDP_TX_DATA_SIZE 1472                // max. outgoing UDP data size (Ethernet MTU)
                                         
+#define ARP_CACHE_SIZE       4                   // nr. of IP-to-MAC translations kept
+#define ARP_CACHE_TTL        120                 // entries expire after 120 aging intervals
+#define ARP_AGING_INTERVAL   100                 // aging interval = 100 ticks (1 sec.)
+
+#define CS8900_SLEEP_TIME    3000                // TCPIdle() puts the CS8900 to sleep after
+                                                 // 30 sec. w/o traffic and connections (0 =
+                                                 // never). the frame that wakes it is lost!
+
 #define MAX_ETH_TX_DATA_SIZE 60                  // 2nd buffer, used for ARP, ICMP, TCP (even!)
                                                  // enough to echo 32 byte via ICMP
 
 #define DEFAULT_TTL          64                  // Time To Live sent with packets
 
+//#define CHECKSUM_BENCHMARK                     // measure ChecksumAdd() in TCPLowLevelInit()
+#define CHECKSUM_BENCHMARK_SIZES 6               // 20 ... 1500 bytes (see tcpip.c)
+
 // Ethernet network layer definitions
 #define ETH_DA_OFS           0                   // Destination MAC address (48 Bit)
 #define ETH_SA_OFS           6                   // Source MAC address (48 Bit)
@@ -130,6 +170,14 @@
 #define TCP_OPT_MSS          (0x0204)            // Type 2, Option Length 4 (Max. Segment Size)
 #define TCP_OPT_MSS_SIZE     4
 
+// UDP layer definitions
+#define UDP_SRCPORT_OFS      (IP_DATA_OFS + 0)   // Source Port (16 bit)
+#define UDP_DESTPORT_OFS     (IP_DATA_OFS + 2)   // Destination Port (16 bit)
+#define UDP_LENGTH_OFS       (IP_DATA_OFS + 4)   // Length of header and data (16 bit)
+#define UDP_CHKSUM_OFS       (IP_DATA_OFS + 6)   // Checksum Field (16 bit, 0 = none)
+#define UDP_DATA_OFS         (IP_DATA_OFS + 8)   // Datagram Data
+#define UDP_HEADER_SIZE      8
+
 // define some TCP standard-ports, useful for testing...
 #define TCP_PORT_ECHO        7                   // echo
 #define TCP_PORT_DISCARD     9                   // discard
@@ -165,19 +213,112 @@ typedef enum                                     // type of last frame sent. use
   TCP_SYN_FRAME,
   TCP_SYN_ACK_FRAME,
   TCP_FIN_FRAME,
-  TCP_DATA_FRAME
+  TCP_DATA_FRAME,
+  TCP_WINDOW_PROBE                               // (persist timer, zero window)
 } TLastFrameSent;
 
+typedef void (*TTCPRxHandler)(unsigned char Socket, unsigned int Count);  // see TCPReadRx()
+
+typedef void (*TUDPRxHandler)(unsigned char Socket, const unsigned int *IP,  // see UDPBind()
+  unsigned int Port, unsigned int Count);
+
+typedef struct                                   // TCP control block, one per socket
+{
+  TTCPStateMachine State;                        // state of the TCP state machine
+  TLastFrameSent LastFrame;                      // retransmission type
+  unsigned long SeqNr;                           // oldest unacknowledged sequence number
+  unsigned long UNASeqNr;                        // next sequence number to send
+  unsigned long AckNr;                           // next seq to receive and ack to send
+  unsigned long SegEnd[TCP_MAX_SEGS_IN_FLIGHT];  // end of each data segment in flight
+  unsigned char SegHead;                         // oldest segment in flight
+  unsigned char SegCount;                        // nr. of segments in flight
+  unsigned int SndWnd;                           // window advertised by the other TCP
+  unsigned int TimerStart;                       // 'TCPTimer' when the timer was started
+  unsigned char Retries;                         // nr. of retransmissions left
+  unsigned char DupAcks;                         // nr. of duplicate ACKs in a row
+  unsigned int RTO;                              // retransmission timeout (ticks)
+  unsigned int SRTT;                             // smoothed round-trip time (ticks x 8)
+  unsigned int RTTVAR;                           // round-trip time variation (ticks x 4)
+  unsigned long RTTSeqNr;                        // end of the segment being timed...
+  unsigned int RTTStart;                         // ...and 'TCPTimer' when it was sent
+  unsigned int AckTimerStart;                    // 'TCPTimer' when an ACK became pending
+  unsigned char Flags;                           // see 'TCPFlags'
+  unsigned char Status;                          // see 'SocketStatus'
+  unsigned int LocalPort;                        // TCP ports
+  unsigned int RemotePort;
+  unsigned int MAC[3];                           // MAC and IP of the other TCP
+  unsigned int IP[2];
+  unsigned int TxRewind;                         // see 'TCPTxRewind'
+  unsigned int TxWindow;                         // see 'TCPTxWindow'
+  unsigned int RxOfs;                            // oldest rec'd segment in the receive
+  unsigned int RxCount;                          // ring (see 'TCP_RX_BUF', 'TCPRxDataCount')
+  unsigned int RcvEdge;                          // right edge of the last advertised window
+  TTCPRxHandler RxHandler;                       // see 'TCPRxHandler'
+  unsigned int IdleTimeout;                      // see 'TCPIdleTimeout'
+  unsigned int IdleStart;                        // 'TCPTimer' when data last went in/out
+  unsigned int Header[TCP_DATA_OFS / 2];         // Ethernet, IP and TCP header template and
+  unsigned int IPSum;                            // the sums of its constant fields (see
+  unsigned int TCPSum;                           // TCPBuildHeader())
+} TTCPSocket;
+
+typedef struct                                   // UDP port bound by UDPBind()
+{
+  unsigned int LocalPort;                        // 0 = not bound
+  TUDPRxHandler RxHandler;                       // 0 or function that gets rec'd datagrams
+} TUDPSocket;
+
+typedef struct                                   // entry of the ARP cache
+{
+  unsigned int IP[2];                            // IP address of a host or gateway...
+  unsigned int MAC[3];                           // ...and its MAC address
+  unsigned char TTL;                             // aging intervals left, 0 = entry unused
+} TARPCacheEntry;
+
+typedef struct                                   // time spent by TCPIdle() in LPM3 and
+{                                                // between two TCPIdle() calls, in Timer_A
+  unsigned long Active;                          // counts (4us, wraps after 4.7 hours)
+  unsigned long Asleep;
+  unsigned int Wakeups;                          // nr. of times TCPIdle() slept
+} TTCPPowerStats;
+
+typedef struct                                   // results of BenchmarkChecksum(), MCLK
+{                                                // cycles per byte * 100 for each size
+  unsigned int ChecksumAddC[CHECKSUM_BENCHMARK_SIZES];  // C loop
+  unsigned int ChecksumAdd[CHECKSUM_BENCHMARK_SIZES];   // ADDC chains
+} TChecksumBenchmark;
+
 // definitions for 'TransmitControl'
 #define SEND_FRAME1                    (0x01)
 #define SEND_FRAME2                    (0x02)
 
+// definitions for the header word of a receive ring record
+#define RX_REC_LENGTH_MASK             (0x0fff)  // nr. of data bytes
+#define RX_REC_SOCKET_MASK             (0x7000)  // index of the socket it belongs to
+#define RX_REC_SOCKET_SHIFT            12
+#define RX_REC_RELEASED                (0x8000)  // free again, skipped by the stack
+#define RX_REC_SIZE(Header)            (2 + ((((Header) & RX_REC_LENGTH_MASK) + 1) & ~1))
+#define RX_RING_NO_ROOM                (0xffff)  // see RxRingReserve()
+
+// 'Count' passed to a receive handler if the data of the last call was
+// corrupted (the other TCP sends it again)
+#define TCP_RX_CORRUPTED               (0xffff)
+#define UDP_RX_CORRUPTED               (0xffff)  // (same for a UDP receive handler)
+
+// results of UDPSendTo()
+#define UDP_SENT                       0         // passed to the CS8900
+#define UDP_ERR_ARP_PENDING            1         // MAC unknown yet, an ARP-request is sent
+#define UDP_ERR_BUSY                   2         // CS8900 has no room for the frame
+#define UDP_ERR_SIZE                   3         // more than 'MAX_UDP_TX_DATA_SIZE' bytes
+
 // definitions for 'TCPFlags'
 #define TCP_ACTIVE_OPEN                (0x01)    // easyWEB shall initiate a connection
 #define IP_ADDR_RESOLVED               (0x02)    // IP sucessfully resolved to MAC
 #define TCP_TIMER_RUNNING              (0x04)
 #define TIMER_TYPE_RETRY               (0x08)
 #define TCP_CLOSE_REQUESTED            (0x10)
+#define TCP_RTT_MEASURING              (0x20)    // a segment is being timed
+#define TCP_RTT_VALID                  (0x40)    // SRTT and RTTVAR hold a measurement
+#define TCP_ACK_PENDING                (0x80)    // rec'd data not ACKed yet (delayed ACK)
 
 // definitions for 'SocketStatus'
 #define SOCK_ACTIVE                    (0x01)    // state machine NOT closed
@@ -195,12 +336,24 @@ typedef enum                                     // type of last frame sent. use
 // exported functions
 // easyWEB-API functions
 void TCPLowLevelInit(void);                      // setup timer, LAN-controller, flags...
+void TCPSelectSocket(unsigned char Socket);      // socket the following calls refer to
 void TCPPassiveOpen(void);                       // listen for a connection
 void TCPActiveOpen(void);                        // open connection
 void TCPClose(void);                             // close connection
 void TCPReleaseRxBuffer(void);                   // indicate to discard rec'd packet
+unsigned int TCPReadRx(void *Dest, unsigned int Count);  // read rec'd data in a handler
+void TCPWriteTxBuffer(const void *Source, unsigned int Count);  // append to TxBuffer
+void TCPPatchTxBuffer(unsigned int Ofs, const void *Source,   // overwrite bytes in TxBuffer
+  unsigned int Count);
 void TCPTransmitTxBuffer(void);                  // initiate transfer after TxBuffer is filled
+void TCPTransmitConst(const void *Data, unsigned int Count);  // ...plus constant data
+void UDPBind(unsigned char Socket, unsigned int LocalPort,  // receive datagrams on a port
+  TUDPRxHandler RxHandler);
+unsigned int UDPReadRx(void *Dest, unsigned int Count);  // read rec'd data in a handler
+unsigned char UDPSendTo(unsigned char Socket, const unsigned int *IP,  // send a datagram
+  unsigned int RemotePort, const void *Data, unsigned int Count);
 void DoNetworkStuff(void);                       // network and TCP/IP event processing
+void TCPIdle(void);                              // sleep until there is something to do
 
 // exported constants
 extern const unsigned int MyIP[];                // local IP address
@@ -209,20 +362,37 @@ extern const unsigned int GatewayIP[];           // gateway IP addr (outbount co
 
 // exported variables
 // easyWEB-API global vars and flags
-extern unsigned char SocketStatus;               // API status variable
-extern unsigned int TCPLocalPort;                // TCP ports
-extern unsigned int TCPRemotePort;
-extern unsigned int RemoteMAC[3];                // MAC address of current TCP-session
-extern unsigned int RemoteIP[2];                 // IP address of current TCP-session
-extern unsigned int TCPRxDataCount;              // nr. of bytes rec'd (TCP_RX_BUF)
+extern TTCPSocket *TCPSocket;                    // socket selected by TCPSelectSocket()
 extern unsigned int TCPTxDataCount;              // nr. of bytes to send (TCP_TX_BUF)
-extern unsigned int TxFrame1Mem[];               // outgoing TCP segment
-extern unsigned int RxTCPBufferMem[];            // data of received TCP segment
+extern unsigned int TxFrame1Mem[];               // outgoing TCP data
+extern unsigned int RxTCPBufferMem[];            // receive ring (segments of all sockets)
+extern TTCPPowerStats TCPPowerStats;             // active vs. asleep (see TCPIdle())
+extern volatile unsigned char TCPUserEvent;      // set by an ISR of the user, TCPIdle()
+                                                 // doesn't sleep then
+#ifdef CHECKSUM_BENCHMARK
+extern TChecksumBenchmark ChecksumBenchmarkResult;
+#endif
+
+// easyWEB-API vars of the selected socket
+#define SocketStatus    (TCPSocket->Status)      // API status variable
+#define TCPLocalPort    (TCPSocket->LocalPort)   // TCP ports
+#define TCPRemotePort   (TCPSocket->RemotePort)
+#define RemoteMAC       (TCPSocket->MAC)         // MAC address of current TCP-session
+#define RemoteIP        (TCPSocket->IP)          // IP address of current TCP-session
+#define TCPTxRewind     (TCPSocket->TxRewind)    // nr. of bytes the user has to send again
+#define TCPTxWindow     (TCPSocket->TxWindow)    // max. nr. of bytes of the next segment, set
+                                                 // with 'SOCK_TX_BUF_RELEASED' (read only)
+#define TCPRxDataCount  (TCPSocket->RxCount)     // nr. of bytes rec'd (TCP_RX_BUF)
+#define TCPTxInFlight   (TCPSocket->SegCount)    // nr. of segments not ACKed yet (read only)
+#define TCPRxHandler    (TCPSocket->RxHandler)   // 0 or function that gets rec'd data
+                                                 // straight from the CS8900 (TCPReadRx())
+#define TCPIdleTimeout  (TCPSocket->IdleTimeout) // ticks w/o data in either direction
+                                                 // after which the stack closes an
+                                                 // established connection (0 = never)
 
 // easyWEB-API TCP data buffer-pointers
-#define TCP_TX_BUF      ((unsigned char *)TxFrame1Mem + ETH_HEADER_SIZE + \
-                          IP_HEADER_SIZE + TCP_HEADER_SIZE)
-#define TCP_RX_BUF      ((unsigned char *)RxTCPBufferMem)
+#define TCP_TX_BUF      ((unsigned char *)TxFrame1Mem)
+#define TCP_RX_BUF      ((unsigned char *)RxTCPBufferMem + TCPSocket->RxOfs)
 
 #endif
 
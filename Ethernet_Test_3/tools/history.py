@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#-------------------------------------------------------------------------------
+# Name: history.py
+# Func: downloads the sensor history of easyWEB ('/history') and prints it
+#       as CSV: sample nr., age in seconds, raw results of the channels
+# Ver.: 1.1
+# Date: October 2026
+# Rem.: usage: history.py [url|file [period]]
+#       - the format is described in easyweb.h ('HISTORY_...'). 'period'
+#         is the time between two samples (sec., 'HISTORY_PERIOD' * 100ms),
+#         the newest sample is taken as 0 sec. old
+#-------------------------------------------------------------------------------
+import sys
+import urllib.request
+
+CHANNELS = ('ad7', 'temp')                       # 'ADC_AD7'... (easyweb.h)
+BLOCK_SIZE = 32                                  # 'HISTORY_BLOCK_SIZE'
+HEADER_SIZE = 2 + 2 * len(CHANNELS)              # 'HISTORY_HEADER_SIZE'
+
+
+def samples(data):
+  """yields (sample nr., values) of each sample in 'data'"""
+  for start in range(0, len(data), BLOCK_SIZE):
+    block = data[start:start + BLOCK_SIZE]
+    if len(block) < HEADER_SIZE:
+      sys.exit('incomplete block at %u' % start)
+    nr = int.from_bytes(block[0:2], 'little')
+    values = [int.from_bytes(block[2 + 2 * i:4 + 2 * i], 'little') for i in range(len(CHANNELS))]
+    yield nr, list(values)
+
+    i = HEADER_SIZE
+    while i < len(block) and block[i] != 0xff:   # differences up to the end of the block
+      for n in range(len(CHANNELS)):
+        code = block[i]
+        if code & 0x80:
+          diff = (code & 0x3f) << 8 | block[i + 1]
+          diff -= 0x4000 if diff & 0x2000 else 0
+          i += 2
+        else:
+          diff = code - 0x80 if code & 0x40 else code
+          i += 1
+        values[n] += diff
+      nr = (nr + 1) & 0xffff
+      yield nr, list(values)
+
+
+def main():
+  source = sys.argv[1] if len(sys.argv) > 1 else 'http://192.168.1.30/history'
+  period = float(sys.argv[2]) if len(sys.argv) > 2 else 2.0
+
+  if '://' in source:
+    data = urllib.request.urlopen(source).read()
+  else:
+    with open(source, 'rb') as f:
+      data = f.read()
+
+  history = list(samples(data))
+  if not history:
+    return
+  newest = history[-1][0]
+
+  print('sample,age,' + ','.join(CHANNELS))
+  for nr, values in history:
+    print('%u,%.1f,%s' % (nr, ((newest - nr) & 0xffff) * period, ','.join(map(str, values))))
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+#-------------------------------------------------------------------------------
+# Name: mkcontent.py
+# Func: builds webcontent.h, the web content in flash: the placeholder index
+#       and the gzip encoding of the webside in webside.h, and the files in
+#       web/ (minified and gzipped)
+# Ver.: 1.1
+# Date: October 2026
+# Rem.: usage: mkcontent.py [webside.h [web [webcontent.h]]]
+#       - run it after each change of webside.h or web/. the makefile of the
+#         host build does so, the IAR and CCS projects use webcontent.h as it
+#         is (easyweb.c doesn't compile if it doesn't fit the page)
+#       - a placeholder ("AD7%" or "ADA%") is replaced by a value of the
+#         same width when the page is sent (see TransmitContent()), the
+#         '%' is sent as it is. max. width is 'WEB_MAX_VALUE_WIDTH' (5)
+#       - the gzip encoding of the webside compresses the parts between the
+#         placeholders on their own (full flush) and keeps each placeholder
+#         in a stored block, so its value can be inserted at a fixed offset.
+#         the CRC-32 of the gzip trailer is corrected for the values by
+#         easyweb.c (GetContentCRC()) with the constants of the index.
+#       - a gzip encoding is only kept if it is smaller
+#       - each body w/o placeholders gets an entity tag (the CRC-32 of its
+#         bytes) for conditional requests ('If-None-Match')
+#-------------------------------------------------------------------------------
+import os
+import re
+import sys
+import zlib
+
+MAX_VALUE_WIDTH = 5                              # 'WEB_MAX_VALUE_WIDTH' (easyweb.h)
+
+PLACEHOLDERS = {                                 # key: value kind, nr. of chars replaced
+  b'AD7%': ('WEB_VALUE_AD7', 3),                 # AD-converter channel 7 (P6.7)
+  b'ADA%': ('WEB_VALUE_TEMP', 3),                # temperature diode (channel 10)
+}
+
+TYPES = {                                        # 'Content-Type' by file extension
+  '.html': 'text/html', '.htm': 'text/html', '.css': 'text/css',
+  '.js': 'application/javascript', '.json': 'application/json',
+  '.svg': 'image/svg+xml', '.txt': 'text/plain', '.ico': 'image/x-icon',
+  '.png': 'image/png', '.gif': 'image/gif', '.jpg': 'image/jpeg',
+}
+
+ESCAPES = {'n': 10, 'r': 13, 't': 9, '0': 0, '"': 34, "'": 39, '\\': 92, '?': 63}
+
+CRC_POLY = 0xedb88320                            # CRC-32 of gzip (reflected)
+
+
+def tokens(text):
+  """yields the C tokens we are interested in: identifiers, strings
+  (unescaped, as bytes) and single chars. comments are skipped."""
+  i = 0
+  while i < len(text):
+    c = text[i]
+    if text.startswith('//', i):
+      i = text.find('\n', i)
+      if i < 0: return
+    elif text.startswith('/*', i):
+      i = text.index('*/', i) + 2
+    elif c == '"':
+      data = bytearray()
+      i += 1
+      while text[i] != '"':
+        if text[i] == '\\':
+          m = re.match(r'x([0-9a-fA-F]{1,2})|([0-7]{1,3})', text[i + 1:])
+          if m and m.group(1):
+            data.append(int(m.group(1), 16))
+          elif m:
+            data.append(int(m.group(2), 8))
+          else:
+            data.append(ESCAPES[text[i + 1]])
+          i += 1 + (len(m.group(0)) if m else 1)
+        else:
+          data.append(ord(text[i]))              # (read as Latin-1)
+          i += 1
+      yield ('string', bytes(data))
+      i += 1
+    elif c.isalnum() or c == '_':
+      m = re.match(r'\w+', text[i:])
+      yield ('name', m.group(0))
+      i += len(m.group(0))
+    elif c.isspace():
+      i += 1
+    else:
+      yield ('char', c)
+      i += 1
+
+
+def webside(path):
+  """returns the contents of 'WebSide' w/o the terminating 0"""
+  with open(path, encoding='latin-1') as f:
+    toks = list(tokens(f.read()))
+
+  for n in range(len(toks)):
+    if toks[n] == ('name', 'WebSide') and toks[n + 1:n + 4] == [('char', '['), ('char', ']'),
+      ('char', '=')]:
+      page = b''
+      for kind, value in toks[n + 4:]:
+        if kind == 'string':
+          page += value                          # (adjacent strings are concatenated)
+        elif value == ';':
+          return page
+  sys.exit('%s: no WebSide[] found' % path)
+
+
+def index(page):
+  """returns (offset, width, kind) of each placeholder in 'page'"""
+  found = []
+  for key, (kind, width) in PLACEHOLDERS.items():
+    assert width <= MAX_VALUE_WIDTH
+    found += [(m.start(), width, kind) for m in re.finditer(re.escape(key), page)]
+  return sorted(found)
+
+
+def crc_mult(a, b):
+  """a * b modulo the CRC polynomial (reflected, see zlib's multmodp())"""
+  m = 1 << 31
+  p = 0
+  while True:
+    if a & m:
+      p ^= b
+      if not a & (m - 1):
+        return p
+    m >>= 1
+    b = (b >> 1) ^ CRC_POLY if b & 1 else b >> 1
+
+
+def crc_shift(count):
+  """x^(8 * count) modulo the CRC polynomial: moves a CRC over 'count'
+  zero bytes"""
+  r = 1 << 31                                    # (x^0)
+  for _ in range(count):
+    r = crc_mult(r, 1 << 23)                     # (x^8)
+  return r
+
+
+def gzip_page(page, values):
+  """returns the gzip encoding of 'page' and its index (offset, width,
+  kind, CRC constant). the placeholders of 'page' ('values') are kept in
+  stored blocks, the CRC-32 of the trailer is a placeholder, too."""
+  deflate = zlib.compressobj(9, zlib.DEFLATED, -15, 9)
+  out = bytearray(b'\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\xff')  # header, no name/time
+  gz_values = []
+  pos = 0
+
+  for ofs, width, kind in values:
+    if ofs > pos:                                # part in front of the value, no
+      out += deflate.compress(page[pos:ofs])     # references behind the value
+      out += deflate.flush(zlib.Z_FULL_FLUSH)
+    out += bytes([0, width & 0xff, width >> 8, ~width & 0xff, (~width >> 8) & 0xff])
+    gz_values.append((len(out), width, kind, crc_shift(len(page) - ofs - width)))
+    out += page[ofs:ofs + width]                 # stored block w/ the template value
+    pos = ofs + width
+
+  out += deflate.compress(page[pos:]) + deflate.flush(zlib.Z_FINISH)
+  gz_values.append((len(out), 4, 'WEB_VALUE_CRC32', zlib.crc32(page)))
+  out += zlib.crc32(page).to_bytes(4, 'little') + len(page).to_bytes(4, 'little')
+
+  assert zlib.decompress(bytes(out), 31) == page
+  return bytes(out), gz_values
+
+
+def minify(name, data):
+  """removes what a browser doesn't need from a text file in web/"""
+  ext = os.path.splitext(name)[1].lower()
+  if ext in ('.html', '.htm', '.svg'):
+    data = re.sub(rb'<!--.*?-->', b'', data, flags=re.S)
+    parts = re.split(rb'(<(pre|textarea|script)\b.*?</\2>)', data, flags=re.S | re.I)
+    data = b''                                   # collapse white space outside of
+    for n in range(0, len(parts), 3):            # <pre>, <textarea> and <script>
+      data += re.sub(rb'\s*\n\s*', b'\n', re.sub(rb'[ \t]+', b' ', parts[n]))
+      if n + 1 < len(parts): data += parts[n + 1]
+    data = data.strip()
+  elif ext == '.css':
+    data = re.sub(rb'/\*.*?\*/', b'', data, flags=re.S)
+    data = re.sub(rb'\s+', b' ', data)
+    data = re.sub(rb' ?([{};:,>]) ?', rb'\1', data).strip()
+  elif ext == '.js':                             # (only white space, strings and regular
+    data = b'\n'.join(l.strip() for l in data.splitlines() if l.strip())  # expressions
+  return data                                    # may contain anything)
+
+
+def c_name(name):
+  """CamelCase array name of a file in web/ ('robots.txt' -> 'RobotsTxt')"""
+  return ''.join(w[:1].upper() + w[1:] for w in re.split(r'[^0-9A-Za-z]+', name) if w)
+
+
+def c_array(name, data):
+  out = ['static const unsigned char %s[] =' % name, '{']
+  for n in range(0, len(data), 12):
+    out.append('  ' + ' '.join('0x%02x,' % b for b in data[n:n + 12]))
+  out[-1] = out[-1].rstrip(',')
+  out.append('};')
+  return out
+
+
+def c_index(name, values):
+  out = ['%-49s// offset, width, value, CRC-32' % ('static const TWebPlaceholder %s[] =' % name),
+    '{']
+  for ofs, width, kind, crc in values:
+    out.append('  { %5u, %u, %s, 0x%08xul },' % (ofs, width, kind, crc))
+  out.append('%-49s// end of the table' % '  { 0xffff, 0, 0, 0 }')
+  out.append('};')
+  return out
+
+
+def c_define(name, value):
+  return '#define %-20s %s' % (name, value)
+
+
+def c_content(data, size, index, body):
+  """initializer of a THTTPContent: 'body' (the bytes) gives the entity tag,
+  'None' if the body has placeholders"""
+  etag = '"\\"%08x\\""' % zlib.crc32(body) if body is not None else '0'
+  return '{ %s, %s, %s, %s }' % (data, size, index, etag)
+
+
+def main():
+  root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+  src = sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, 'webside.h')
+  web = sys.argv[2] if len(sys.argv) > 2 else os.path.join(root, 'web')
+  dst = sys.argv[3] if len(sys.argv) > 3 else os.path.join(root, 'webcontent.h')
+
+  page = webside(src)
+  if len(page) >= 0xffff:
+    sys.exit('%s: WebSide[] too large' % src)
+  values = index(page)
+
+  out = []
+  out.append('//' + '-' * 78)
+  out.append('// Name: webcontent.h')
+  out.append('// Func: web content in flash: placeholders and gzip encoding of \'WebSide\'')
+  out.append('//       (webside.h), files of web/')
+  out.append('// Rem.: generated by tools/mkcontent.py, don\'t edit')
+  out.append('//' + '-' * 78)
+  out.append('')
+  out.append('#ifndef __WEBCONTENT_H')
+  out.append('#define __WEBCONTENT_H')
+  out.append('')
+  out.append('%-49s// size of the page the content' %
+    ('#define WEBSIDE_SIZE         %u' % len(page)))
+  out.append('%-49s// belongs to' % '')
+  out.append('')
+  out += c_index('WebSideIndex', [v + (0,) for v in values])
+  out.append(c_define('WEBSIDE', c_content('WebSide', 'sizeof(WebSide) - 1', 'WebSideIndex',
+    None if values else page)))
+
+  gz, gz_values = gzip_page(page, values)
+  if len(gz) < len(page):
+    out.append('')
+    out.append('// gzip: %u bytes' % len(gz))
+    out += c_array('WebSideGz', gz)
+    out += c_index('WebSideGzIndex', gz_values)
+    out.append(c_define('WEBSIDE_GZ', c_content('WebSideGz', 'sizeof WebSideGz',
+      'WebSideGzIndex', None if values else gz)))
+  else:
+    out.append(c_define('WEBSIDE_GZ', '{ 0, 0, 0, 0 }'))
+
+  for name in sorted(os.listdir(web)) if os.path.isdir(web) else []:
+    with open(os.path.join(web, name), 'rb') as f:
+      data = minify(name, f.read())
+    array = c_name(name)
+    macro = re.sub(r'(?<=[a-z0-9])(?=[A-Z])', '_', array).upper()
+    deflate = zlib.compressobj(9, zlib.DEFLATED, 31, 9)  # (gzip w/o name and time)
+    gz = deflate.compress(data) + deflate.flush()
+
+    out.append('')
+    out.append('// web/%s: %u bytes, gzip: %u bytes' % (name, len(data), len(gz)))
+    out += c_array(array, data)
+    out.append(c_define(macro, c_content(array, 'sizeof ' + array, '0', data)))
+    if len(gz) < len(data):
+      out += c_array(array + 'Gz', gz)
+      out.append(c_define(macro + '_GZ', c_content(array + 'Gz', 'sizeof %sGz' % array, '0',
+        gz)))
+    else:
+      out.append(c_define(macro + '_GZ', '{ 0, 0, 0, 0 }'))
+    out.append(c_define(macro + '_TYPE', '"%s"' % TYPES.get(os.path.splitext(name)[1].lower(),
+      'application/octet-stream')))
+
+  out.append('')
+  out.append('#endif')
+
+  with open(dst, 'w') as f:
+    f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+#-------------------------------------------------------------------------------
+# Name: telemetry.py
+# Func: receives the telemetry of easyWEB (UDP) and prints it as CSV:
+#       sample nr., raw results of the channels, batches dropped so far
+# Ver.: 1.1
+# Date: October 2026
+# Rem.: usage: telemetry.py [port]
+#       - the format is described in easyweb.h ('TELEMETRY_...'). gaps in
+#         the sample nr. are lost batches (dropped by easyWEB or the network)
+#-------------------------------------------------------------------------------
+import socket
+import struct
+import sys
+
+CHANNELS = ('ad7', 'temp')                       # 'ADC_AD7'... (easyweb.h)
+HEADER_SIZE = 4                                  # 'TELEMETRY_HEADER_SIZE'
+
+
+def samples(data):
+  """yields (sample nr., values, dropped) of each sample in the datagram 'data'"""
+  nr, dropped = struct.unpack_from('<HH', data)
+  size = 2 * len(CHANNELS)
+  for ofs in range(HEADER_SIZE, len(data) - size + 1, size):
+    yield nr, struct.unpack_from('<%uH' % len(CHANNELS), data, ofs), dropped
+    nr = (nr + 1) & 0xffff
+
+
+def main():
+  port = int(sys.argv[1]) if len(sys.argv) > 1 else 5150   # 'TELEMETRY_PORT'
+
+  sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+  sock.bind(('', port))
+
+  print('sample,' + ','.join(CHANNELS) + ',dropped', flush=True)
+  while True:
+    data = sock.recv(2048)
+    for nr, values, dropped in samples(data):
+      print('%u,%s,%u' % (nr, ','.join(map(str, values)), dropped), flush=True)
+
+
+if __name__ == '__main__':
+  main()
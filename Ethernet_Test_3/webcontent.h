@@ -0,0 +1,49 @@
+//------------------------------------------------------------------------------
+// Name: webcontent.h
+// Func: web content in flash: placeholders and gzip encoding of 'WebSide'
+//       (webside.h), files of web/
+// Rem.: generated by tools/mkcontent.py, don't edit
+//------------------------------------------------------------------------------
+
+#ifndef __WEBCONTENT_H
+#define __WEBCONTENT_H
+
+#define WEBSIDE_SIZE         81                  // size of the page the content
+                                                 // belongs to
+
+static const TWebPlaceholder WebSideIndex[] =    // offset, width, value, CRC-32
+{
+  { 0xffff, 0, 0, 0 }                            // end of the table
+};
+#define WEBSIDE              { WebSide, sizeof(WebSide) - 1, WebSideIndex, "\"6f3132d3\"" }
+
+// gzip: 76 bytes
+static const unsigned char WebSideGz[] =
+{
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0xb3, 0xc9,
+  0x28, 0xc9, 0xcd, 0xb1, 0xe3, 0xe5, 0xb2, 0xc9, 0x48, 0x4d, 0x4c, 0x01,
+  0xd1, 0xfa, 0x30, 0x46, 0x52, 0x7e, 0x4a, 0x25, 0x88, 0x2e, 0xb0, 0xb3,
+  0x49, 0xb2, 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x08, 0xcf, 0x2f, 0xca,
+  0x49, 0x51, 0xb4, 0xd1, 0x4f, 0xb2, 0xb3, 0xd1, 0x2f, 0x00, 0x2b, 0x86,
+  0x29, 0xd2, 0x87, 0x1a, 0xc3, 0xcb, 0x05, 0x00, 0xd3, 0x32, 0x31, 0x6f,
+  0x51, 0x00, 0x00, 0x00
+};
+static const TWebPlaceholder WebSideGzIndex[] =  // offset, width, value, CRC-32
+{
+  {    68, 4, WEB_VALUE_CRC32, 0x6f3132d3ul },
+  { 0xffff, 0, 0, 0 }                            // end of the table
+};
+#define WEBSIDE_GZ           { WebSideGz, sizeof WebSideGz, WebSideGzIndex, "\"633cf5ea\"" }
+
+// web/robots.txt: 28 bytes, gzip: 48 bytes
+static const unsigned char RobotsTxt[] =
+{
+  0x55, 0x73, 0x65, 0x72, 0x2d, 0x61, 0x67, 0x65, 0x6e, 0x74, 0x3a, 0x20,
+  0x2a, 0x0d, 0x0a, 0x44, 0x69, 0x73, 0x61, 0x6c, 0x6c, 0x6f, 0x77, 0x3a,
+  0x20, 0x2f, 0x0d, 0x0a
+};
+#define ROBOTS_TXT           { RobotsTxt, sizeof RobotsTxt, 0, "\"19cfc2f7\"" }
+#define ROBOTS_TXT_GZ        { 0, 0, 0, 0 }
+#define ROBOTS_TXT_TYPE      "text/plain"
+
+#endif